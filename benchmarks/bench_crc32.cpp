@@ -0,0 +1,18 @@
+#include "bench_data.hxx"
+#include "crc32/crc32.hxx"
+
+#include <benchmark/benchmark.h>
+
+static void BM_CRC32(benchmark::State& state)
+{
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), Entropy::RANDOM);
+
+	for(auto _ : state)
+	{
+		benchmark::DoNotOptimize(crc32(data.data(), data.size()));
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+BENCHMARK(BM_CRC32)->RangeMultiplier(16)->Range(64, 64 << 20);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Input generators shared by the benchmarks, all of them are deterministic for the given arguments
+
+enum class Entropy
+{
+	LOW,    // a handful of words repeated over and over
+	TEXT,   // config or script like text with some binary noise
+	RANDOM  // uniformly random bytes, incompressible
+};
+
+inline std::vector<uint8_t> SampleData(std::size_t size, Entropy entropy)
+{
+	static const std::vector<std::string> words =
+	{
+		"textures", "meshes", "\\", "actors", "stalker", ".dds", ".ogf", "[section]", " = ", "\r\n", "level"
+	};
+
+	std::mt19937 generator(static_cast<unsigned int>(size) * 3 + static_cast<unsigned int>(entropy));
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	std::vector<uint8_t> data;
+	data.reserve(size + 16);
+
+	while(data.size() < size)
+	{
+		if(entropy == Entropy::RANDOM || (entropy == Entropy::TEXT && generator() % 8 == 0))
+		{
+			data.push_back(static_cast<uint8_t>(byte(generator)));
+			continue;
+		}
+
+		const auto& word = words[generator() % (entropy == Entropy::LOW ? 3 : words.size())];
+		data.insert(data.end(), word.begin(), word.end());
+	}
+
+	data.resize(size);
+	return data;
+}
+
+inline const char* EntropyName(Entropy entropy)
+{
+	switch(entropy)
+	{
+		case Entropy::LOW: return "low";
+		case Entropy::TEXT: return "text";
+		default: return "random";
+	}
+}
+
+// Builds an uncompressed 2947 header with the given number of entries, which is what LZHUF
+// is used for in practice: long repetitive paths mixed with random sizes, offsets and checksums.
+inline std::vector<uint8_t> SampleHeader(std::size_t entries)
+{
+	static const std::vector<std::string> folders =
+	{
+		"textures", "meshes", "sounds", "config", "scripts", "levels", "anims", "shaders"
+	};
+
+	static const std::vector<std::string> names =
+	{
+		"act", "wpn", "mp", "ui", "detail", "terrain", "fx", "characters", "weapons", "environment"
+	};
+
+	static const std::vector<std::string> extensions =
+	{
+		".dds", ".ogf", ".ltx", ".ogg", ".script"
+	};
+
+	std::mt19937 generator(static_cast<unsigned int>(entries));
+	auto pick = [&generator](const std::vector<std::string>& values) -> const std::string&
+	{
+		return values[generator() % values.size()];
+	};
+
+	std::vector<uint8_t> header;
+	auto put_u16 = [&header](uint16_t value) { header.insert(header.end(), reinterpret_cast<uint8_t*>(&value), reinterpret_cast<uint8_t*>(&value) + sizeof(value)); };
+	auto put_u32 = [&header](uint32_t value) { header.insert(header.end(), reinterpret_cast<uint8_t*>(&value), reinterpret_cast<uint8_t*>(&value) + sizeof(value)); };
+
+	for(std::size_t i = 0; i < entries; i++)
+	{
+		auto path = pick(folders);
+		for(auto depth = generator() % 4; depth > 0; depth--)
+		{
+			path += "\\" + pick(names);
+		}
+		path += "\\" + pick(names) + "_" + std::to_string(generator() % 5000) + pick(extensions);
+
+		auto size_real = generator() % (1 << 20);
+		put_u16(static_cast<uint16_t>(path.size() + 16));
+		put_u32(size_real);
+		put_u32(generator() % 2 ? size_real : size_real / 2);
+		put_u32(generator());
+		header.insert(header.end(), path.begin(), path.end());
+		put_u32(generator() % (1 << 30));
+	}
+
+	return header;
+}
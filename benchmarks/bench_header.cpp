@@ -0,0 +1,68 @@
+#include "bench_data.hxx"
+#include "entry_table.hxx"
+#include "unpacker.hxx"
+#include "xray_re/xr_lzhuf.hxx"
+#include "xray_re/xr_reader.hxx"
+#include "xray_re/xr_scrambler.hxx"
+#include "xray_re/xr_utils.hxx"
+#include "xray_re/xr_writer.hxx"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace xray_re;
+
+// Archive with an empty data chunk and a header of the given size, packed like Packer does it
+static std::vector<uint8_t> SampleArchive(std::size_t entries, DBVersion version)
+{
+	auto header = SampleHeader(entries);
+
+	uint8_t *code = nullptr;
+	uint32_t code_size = 0;
+	xr_lzhuf::compress(code, code_size, header.data(), static_cast<uint32_t>(header.size()));
+
+	if(version == DBVersion::DB_VERSION_2947RU || version == DBVersion::DB_VERSION_2947WW)
+	{
+		xr_scrambler scrambler(version == DBVersion::DB_VERSION_2947RU ? xr_scrambler::CC_RU : xr_scrambler::CC_WW);
+		scrambler.encrypt(code, code, code_size);
+	}
+
+	xr_memory_writer w;
+	w.open_chunk(DB_CHUNK_DATA);
+	w.close_chunk();
+	w.open_chunk(DB_CHUNK_HEADER | CHUNK_COMPRESSED);
+	w.w_raw(code, code_size);
+	w.close_chunk();
+	free(code);
+
+	return std::vector<uint8_t>(w.data(), w.data() + w.tell());
+}
+
+// Descrambling, LZHUF decoding and record parsing of the header, i.e. what opening an archive costs.
+// range(0) is the number of entries, range(1) the DBVersion.
+static void BM_Header_Read(benchmark::State& state)
+{
+	auto version = static_cast<DBVersion>(state.range(1));
+	auto archive = SampleArchive(static_cast<std::size_t>(state.range(0)), version);
+
+	EntryTable entries;
+	for(auto _ : state)
+	{
+		xr_reader reader(archive.data(), archive.size());
+		if(!Unpacker::read_files("", &reader, version, entries))
+		{
+			state.SkipWithError("failed to read the header");
+			return;
+		}
+		benchmark::DoNotOptimize(entries.size());
+	}
+
+	state.SetLabel(version == DBVersion::DB_VERSION_XDB ? "xdb" : "2947ru");
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * entries.size()));
+}
+
+BENCHMARK(BM_Header_Read)
+	->ArgsProduct({{1000, 10000, 100000}, {static_cast<int64_t>(DBVersion::DB_VERSION_XDB), static_cast<int64_t>(DBVersion::DB_VERSION_2947RU)}})
+	->Unit(benchmark::kMillisecond);
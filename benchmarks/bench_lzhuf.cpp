@@ -0,0 +1,97 @@
+#include "bench_data.hxx"
+#include "xray_re/xr_lzhuf.hxx"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace xray_re;
+
+static void BM_LZHUF_Compress(benchmark::State& state)
+{
+	auto header = SampleHeader(static_cast<std::size_t>(state.range(0)));
+	xr_lzhuf_context context;
+
+	for(auto _ : state)
+	{
+		uint8_t *code = nullptr;
+		uint32_t code_size = 0;
+		xr_lzhuf::compress(context, code, code_size, header.data(), static_cast<uint32_t>(header.size()));
+		benchmark::DoNotOptimize(code);
+		free(code);
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * header.size()));
+}
+
+static void BM_LZHUF_Decompress(benchmark::State& state)
+{
+	auto header = SampleHeader(static_cast<std::size_t>(state.range(0)));
+	xr_lzhuf_context context;
+
+	uint8_t *code = nullptr;
+	uint32_t code_size = 0;
+	xr_lzhuf::compress(context, code, code_size, header.data(), static_cast<uint32_t>(header.size()));
+	state.counters["ratio"] = static_cast<double>(code_size) / header.size();
+
+	for(auto _ : state)
+	{
+		uint8_t *text = nullptr;
+		uint32_t text_size = 0;
+		xr_lzhuf::decompress(context, text, text_size, code, code_size);
+		benchmark::DoNotOptimize(text);
+		free(text);
+	}
+
+	free(code);
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * header.size()));
+}
+
+// arbitrary data: range(0) is the size, range(1) the Entropy
+static void BM_LZHUF_CompressData(benchmark::State& state)
+{
+	auto entropy = static_cast<Entropy>(state.range(1));
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), entropy);
+	xr_lzhuf_context context;
+
+	for(auto _ : state)
+	{
+		uint8_t *code = nullptr;
+		uint32_t code_size = 0;
+		xr_lzhuf::compress(context, code, code_size, data.data(), static_cast<uint32_t>(data.size()));
+		benchmark::DoNotOptimize(code);
+		free(code);
+	}
+
+	state.SetLabel(EntropyName(entropy));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+static void BM_LZHUF_DecompressData(benchmark::State& state)
+{
+	auto entropy = static_cast<Entropy>(state.range(1));
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), entropy);
+	xr_lzhuf_context context;
+
+	uint8_t *code = nullptr;
+	uint32_t code_size = 0;
+	xr_lzhuf::compress(context, code, code_size, data.data(), static_cast<uint32_t>(data.size()));
+	state.counters["ratio"] = static_cast<double>(code_size) / data.size();
+
+	std::vector<uint8_t> text(data.size());
+	for(auto _ : state)
+	{
+		xr_lzhuf::decompress_into(text.data(), static_cast<uint32_t>(text.size()), code, code_size);
+		benchmark::DoNotOptimize(text.data());
+	}
+
+	free(code);
+	state.SetLabel(EntropyName(entropy));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+BENCHMARK(BM_LZHUF_Compress)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LZHUF_Decompress)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LZHUF_CompressData)->ArgsProduct({{4 << 10, 64 << 10, 1 << 20}, {0, 1, 2}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LZHUF_DecompressData)->ArgsProduct({{4 << 10, 64 << 10, 1 << 20}, {0, 1, 2}})->Unit(benchmark::kMillisecond);
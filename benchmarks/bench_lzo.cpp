@@ -0,0 +1,55 @@
+#include "bench_data.hxx"
+#include "lzo_codec.hxx"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace xray_re;
+
+// range(0) is the size, range(1) the Entropy
+static void BM_LZO_Compress(benchmark::State& state)
+{
+	auto entropy = static_cast<Entropy>(state.range(1));
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), entropy);
+	LZOCodec::init();
+
+	std::vector<uint8_t> compressed;
+	for(auto _ : state)
+	{
+		benchmark::DoNotOptimize(LZOCodec::compress(compressed, data.data(), data.size(), CompressionLevel::FAST));
+	}
+
+	state.SetLabel(EntropyName(entropy));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+// LZOCodec::decompress is a thin wrapper of lzo1x_decompress_safe
+static void BM_LZO_Decompress(benchmark::State& state)
+{
+	auto entropy = static_cast<Entropy>(state.range(1));
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), entropy);
+	LZOCodec::init();
+
+	std::vector<uint8_t> compressed;
+	if(!LZOCodec::compress(compressed, data.data(), data.size(), CompressionLevel::FAST))
+	{
+		// the packer stores such files as is, so there is nothing to decompress
+		state.SkipWithError("data is not compressible");
+		return;
+	}
+
+	state.counters["ratio"] = static_cast<double>(compressed.size()) / data.size();
+
+	std::vector<uint8_t> decompressed(data.size());
+	for(auto _ : state)
+	{
+		benchmark::DoNotOptimize(LZOCodec::decompress(decompressed.data(), decompressed.size(), compressed.data(), compressed.size()));
+	}
+
+	state.SetLabel(EntropyName(entropy));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+BENCHMARK(BM_LZO_Compress)->ArgsProduct({{4 << 10, 64 << 10, 1 << 20, 16 << 20}, {0, 1, 2}});
+BENCHMARK(BM_LZO_Decompress)->ArgsProduct({{4 << 10, 64 << 10, 1 << 20, 16 << 20}, {0, 1}});
@@ -0,0 +1,187 @@
+#include "corpus.hxx"
+#include "db_tools.hxx"
+
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace xray_re;
+
+namespace fs = std::filesystem;
+
+// End-to-end packing and unpacking of synthetic trees, see CorpusPresets().
+// Arguments: range(0) is the preset, range(1) the DBVersion, range(2) 1 to compress files with LZO.
+// Besides wall time and throughput every run reports the read/write family syscalls issued
+// (from /proc/self/io) and the peak RSS (VmHWM, reset through /proc/self/clear_refs).
+
+struct ProcessStats
+{
+	uint64_t read_calls{0};
+	uint64_t write_calls{0};
+};
+
+static ProcessStats ReadProcessStats()
+{
+	ProcessStats stats;
+
+	std::ifstream io("/proc/self/io");
+	std::string key;
+	uint64_t value;
+	while(io >> key >> value)
+	{
+		if(key == "syscr:")
+		{
+			stats.read_calls = value;
+		}
+		else if(key == "syscw:")
+		{
+			stats.write_calls = value;
+		}
+	}
+
+	return stats;
+}
+
+static void ResetPeakRSS()
+{
+	std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+static double PeakRSSMiB()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line))
+	{
+		if(line.rfind("VmHWM:", 0) == 0)
+		{
+			std::istringstream fields(line.substr(6));
+			uint64_t kilobytes = 0;
+			fields >> kilobytes;
+			return kilobytes / 1024.0;
+		}
+	}
+
+	return 0;
+}
+
+static const char* VersionName(DBVersion version)
+{
+	switch(version)
+	{
+		case DBVersion::DB_VERSION_2947RU: return "2947ru";
+		case DBVersion::DB_VERSION_2947WW: return "2947ww";
+		default: return "xdb";
+	}
+}
+
+struct Pipeline
+{
+	explicit Pipeline(const benchmark::State& state) :
+		spec(CorpusPresets()[static_cast<std::size_t>(state.range(0))]),
+		version(static_cast<DBVersion>(state.range(1))),
+		compression(state.range(2) ? CompressionLevel::FAST : CompressionLevel::NONE)
+	{
+		spdlog::set_level(spdlog::level::warn);
+
+		auto root = fs::temp_directory_path() / "db_converter" / "bench_pipeline" / spec.name;
+		source = (root / "source").string() + "/";
+		archive = (root / (std::string(VersionName(version)) + (state.range(2) ? "_lzo" : "") + ".db")).string();
+		output = (root / "output").string();
+
+		bytes = WriteCorpus(spec, (root / "source").string());
+	}
+
+	void pack() const
+	{
+		DBTools::pack(source, archive, version, "", false, 1, compression);
+	}
+
+	void unpack() const
+	{
+		DBTools::unpack(archive, output, version, "", false, 1);
+	}
+
+	void report(benchmark::State& state, const ProcessStats& before, const ProcessStats& after, double peak_rss) const
+	{
+		state.SetLabel(std::string(spec.name) + "/" + VersionName(version) + (compression == CompressionLevel::NONE ? "" : "/lzo"));
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+		state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * spec.files));
+		state.counters["read_calls"] = benchmark::Counter(static_cast<double>(after.read_calls - before.read_calls), benchmark::Counter::kAvgIterations);
+		state.counters["write_calls"] = benchmark::Counter(static_cast<double>(after.write_calls - before.write_calls), benchmark::Counter::kAvgIterations);
+		state.counters["peak_rss_MiB"] = peak_rss;
+	}
+
+	const CorpusSpec& spec;
+	DBVersion version;
+	CompressionLevel compression;
+
+	std::string source;
+	std::string archive;
+	std::string output;
+	uint64_t bytes{0};
+};
+
+static void BM_Pipeline_Pack(benchmark::State& state)
+{
+	Pipeline pipeline(state);
+
+	ResetPeakRSS();
+	auto before = ReadProcessStats();
+
+	for(auto _ : state)
+	{
+		pipeline.pack();
+	}
+
+	pipeline.report(state, before, ReadProcessStats(), PeakRSSMiB());
+}
+
+static void BM_Pipeline_Unpack(benchmark::State& state)
+{
+	Pipeline pipeline(state);
+	pipeline.pack();
+
+	ProcessStats used;
+	ResetPeakRSS();
+
+	for(auto _ : state)
+	{
+		state.PauseTiming();
+		fs::remove_all(pipeline.output);
+		auto before = ReadProcessStats();
+		state.ResumeTiming();
+
+		pipeline.unpack();
+
+		state.PauseTiming();
+		auto after = ReadProcessStats();
+		used.read_calls += after.read_calls - before.read_calls;
+		used.write_calls += after.write_calls - before.write_calls;
+		state.ResumeTiming();
+	}
+
+	pipeline.report(state, ProcessStats(), used, PeakRSSMiB());
+	fs::remove_all(pipeline.output);
+}
+
+static void PipelineArguments(benchmark::internal::Benchmark *benchmark)
+{
+	for(int64_t preset = 0; preset < static_cast<int64_t>(CorpusPresets().size()); preset++)
+	{
+		for(auto version : {DBVersion::DB_VERSION_XDB, DBVersion::DB_VERSION_2947RU, DBVersion::DB_VERSION_2947WW})
+		{
+			for(int64_t compress : {0, 1})
+			{
+				benchmark->Args({preset, static_cast<int64_t>(version), compress});
+			}
+		}
+	}
+}
+
+BENCHMARK(BM_Pipeline_Pack)->Apply(PipelineArguments)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Pipeline_Unpack)->Apply(PipelineArguments)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,46 @@
+#include "bench_data.hxx"
+#include "xray_re/xr_scrambler.hxx"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace xray_re;
+
+// range(0) is the size, range(1) the cipher config
+static void BM_Scrambler_Encrypt(benchmark::State& state)
+{
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), Entropy::TEXT);
+	xr_scrambler scrambler(static_cast<xr_scrambler::cipher_config>(state.range(1)));
+
+	std::vector<uint8_t> encrypted(data.size());
+	for(auto _ : state)
+	{
+		scrambler.encrypt(encrypted.data(), data.data(), data.size());
+		benchmark::DoNotOptimize(encrypted.data());
+	}
+
+	state.SetLabel(state.range(1) == xr_scrambler::CC_RU ? "ru" : "ww");
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+static void BM_Scrambler_Decrypt(benchmark::State& state)
+{
+	auto data = SampleData(static_cast<std::size_t>(state.range(0)), Entropy::TEXT);
+	xr_scrambler scrambler(static_cast<xr_scrambler::cipher_config>(state.range(1)));
+
+	std::vector<uint8_t> encrypted(data.size());
+	scrambler.encrypt(encrypted.data(), data.data(), data.size());
+
+	for(auto _ : state)
+	{
+		scrambler.decrypt(data.data(), encrypted.data(), encrypted.size());
+		benchmark::DoNotOptimize(data.data());
+	}
+
+	state.SetLabel(state.range(1) == xr_scrambler::CC_RU ? "ru" : "ww");
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+BENCHMARK(BM_Scrambler_Encrypt)->ArgsProduct({{4 << 10, 256 << 10, 4 << 20}, {xr_scrambler::CC_RU, xr_scrambler::CC_WW}});
+BENCHMARK(BM_Scrambler_Decrypt)->ArgsProduct({{4 << 10, 256 << 10, 4 << 20}, {xr_scrambler::CC_RU, xr_scrambler::CC_WW}});
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "bench_data.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Shape of a synthetic game-like folder tree. File sizes are log-uniform between
+// min_size and max_size, which gives many small files and a few big ones like real archives.
+struct CorpusSpec
+{
+	const char *name;
+	std::size_t files;
+	std::size_t min_size;
+	std::size_t max_size;
+	Entropy entropy;
+	std::size_t depth;   // folder levels above the files
+	std::size_t fanout;  // subfolders of every folder
+};
+
+inline const std::vector<CorpusSpec>& CorpusPresets()
+{
+	static const std::vector<CorpusSpec> presets =
+	{
+		{"configs",  5000, 100,       8 << 10, Entropy::TEXT,   3, 8},
+		{"mixed",    1000, 1 << 10, 512 << 10, Entropy::TEXT,   4, 6},
+		{"textures",   64, 256 << 10, 4 << 20, Entropy::RANDOM, 2, 4}
+	};
+
+	return presets;
+}
+
+struct CorpusFile
+{
+	std::string path;  // relative, '/' separated
+	std::size_t size;
+};
+
+// Deterministic list of files for the spec, nothing is written
+inline std::vector<CorpusFile> CorpusLayout(const CorpusSpec& spec)
+{
+	std::mt19937 generator(static_cast<unsigned int>(spec.files * 31 + spec.depth));
+	std::uniform_real_distribution<double> exponent(std::log(static_cast<double>(spec.min_size)), std::log(static_cast<double>(spec.max_size)));
+
+	const char *extension = spec.entropy == Entropy::RANDOM ? ".dds" : ".ltx";
+
+	std::vector<CorpusFile> files;
+	files.reserve(spec.files);
+
+	for(std::size_t i = 0; i < spec.files; i++)
+	{
+		std::string path;
+		for(std::size_t level = 0; level < spec.depth; level++)
+		{
+			path += "d" + std::to_string(level) + "_" + std::to_string(generator() % std::max<std::size_t>(spec.fanout, 1)) + "/";
+		}
+		path += "f" + std::to_string(i) + extension;
+
+		files.push_back({path, static_cast<std::size_t>(std::exp(exponent(generator)))});
+	}
+
+	return files;
+}
+
+// Writes the tree under root unless it is already there, returns the total size of the files
+inline uint64_t WriteCorpus(const CorpusSpec& spec, const std::string& root)
+{
+	namespace fs = std::filesystem;
+
+	auto files = CorpusLayout(spec);
+
+	uint64_t total = 0;
+	for(const auto& file : files)
+	{
+		total += file.size;
+	}
+
+	// next to the tree, not inside, or it would get packed too
+	auto marker = fs::path(root).parent_path() / (fs::path(root).filename().string() + ".complete");
+	if(fs::exists(marker))
+	{
+		return total;
+	}
+
+	fs::remove_all(root);
+	fs::create_directories(root);
+
+	// a few distinct contents per size class keep generation fast without making every file alike
+	std::mt19937 generator(static_cast<unsigned int>(spec.files));
+	for(const auto& file : files)
+	{
+		auto path = fs::path(root) / file.path;
+		fs::create_directories(path.parent_path());
+
+		auto data = SampleData(file.size + generator() % 4, spec.entropy);
+		data.resize(file.size);
+
+		std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	}
+
+	std::ofstream(marker).put('\n');
+	return total;
+}
@@ -0,0 +1,247 @@
+#include "archive_generator.hxx"
+#include "lzo_codec.hxx"
+#include "crc32/crc32.hxx"
+#include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_lzhuf.hxx"
+#include "xray_re/xr_scrambler.hxx"
+#include "xray_re/xr_utils.hxx"
+#include "xray_re/xr_writer.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace xray_re;
+
+// splitmix64, good enough to make independent looking values out of consecutive indices
+static uint64_t Mix(uint64_t value)
+{
+	value += 0x9e3779b97f4a7c15ull;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+ArchiveGenerator::ArchiveGenerator(const ArchiveSpec& spec) : m_spec(spec)
+{
+	m_spec.min_size = std::max<std::size_t>(m_spec.min_size, 1);
+	m_spec.max_size = std::max(m_spec.max_size, m_spec.min_size);
+	m_spec.fanout = std::max<std::size_t>(m_spec.fanout, 1);
+}
+
+bool ArchiveGenerator::write(const std::string& path) const
+{
+	auto version = m_spec.version;
+	if(version == DBVersion::DB_VERSION_AUTO)
+	{
+		spdlog::error("Unspecified DB format");
+		return false;
+	}
+
+	if(m_spec.compress && version != DBVersion::DB_VERSION_1114 && !LZOCodec::init())
+	{
+		return false;
+	}
+
+	xr_file_system& fs = xr_file_system::instance();
+	auto w = fs.w_open(path, true);
+	if(!w)
+	{
+		spdlog::error("Failed to open {}", path);
+		return false;
+	}
+
+	xr_memory_writer header;
+	std::vector<uint8_t> compressed;
+
+	// offsets and sizes are 32-bit in every format, the data has to end below 4 GiB
+	auto is_too_big = [&](std::size_t entry)
+	{
+		if(w->tell() <= UINT32_MAX)
+		{
+			return false;
+		}
+
+		spdlog::error("Data of {} passes 4 GiB at entry {}", path, entry);
+		fs.w_close(w);
+		return true;
+	};
+
+	w->open_chunk(DB_CHUNK_DATA);
+	for(std::size_t i = 0; i < m_spec.entries; i++)
+	{
+		if(i > 0 && is_too_big(i - 1))
+		{
+			return false;
+		}
+
+		auto data = entry_data(i);
+		auto name = entry_path(i);
+		std::replace(name.begin(), name.end(), '/', '\\');
+
+		auto offset = static_cast<uint32_t>(w->tell());
+		auto size_real = static_cast<uint32_t>(data.size());
+		auto size_compressed = size_real;
+
+		if(version == DBVersion::DB_VERSION_1114)
+		{
+			// 1114 entries are either stored or LZHUF compressed, the flag tells which
+			if(m_spec.compress)
+			{
+				uint8_t *code = nullptr;
+				xr_lzhuf::compress(code, size_compressed, data.data(), size_real);
+				w->w_raw(code, size_compressed);
+				free(code);
+			}
+			else
+			{
+				w->w_raw(data.data(), size_real);
+			}
+
+			header.w_sz(name);
+			header.w_u32(m_spec.compress ? 0 : 1);
+			header.w_u32(offset);
+			header.w_u32(size_compressed);
+			continue;
+		}
+
+		if(m_spec.compress && LZOCodec::compress(compressed, data.data(), data.size(), CompressionLevel::FAST))
+		{
+			size_compressed = static_cast<uint32_t>(compressed.size());
+			w->w_raw(compressed.data(), compressed.size());
+		}
+		else
+		{
+			w->w_raw(data.data(), data.size());
+		}
+
+		switch(version)
+		{
+			case DBVersion::DB_VERSION_2215:
+			{
+				header.w_sz(name);
+				header.w_u32(offset);
+				header.w_u32(size_real);
+				header.w_u32(size_compressed);
+				break;
+			}
+			case DBVersion::DB_VERSION_2945:
+			{
+				header.w_sz(name);
+				header.w_u32(crc32(data.data(), data.size()));
+				header.w_u32(offset);
+				header.w_u32(size_real);
+				header.w_u32(size_compressed);
+				break;
+			}
+			default:
+			{
+				header.w_size_u16(name.size() + 16);
+				header.w_u32(size_real);
+				header.w_u32(size_compressed);
+				header.w_u32(crc32(data.data(), data.size()));
+				header.w_raw(name.data(), name.size());
+				header.w_u32(offset);
+				break;
+			}
+		}
+	}
+
+	if(m_spec.entries > 0 && is_too_big(m_spec.entries - 1))
+	{
+		return false;
+	}
+	w->close_chunk();
+
+	write_header(*w, std::vector<uint8_t>(header.data(), header.data() + header.tell()));
+
+	auto is_written = w->sync();
+	fs.w_close(w);
+	if(!is_written)
+	{
+		spdlog::error("Failed to write {}", path);
+	}
+
+	return is_written;
+}
+
+std::string ArchiveGenerator::entry_path(std::size_t index) const
+{
+	static const char *folders[] = {"config", "meshes", "textures", "scripts", "sounds", "levels", "anims", "shaders"};
+	static const char *extensions[] = {".ltx", ".ogf", ".dds", ".script", ".ogg"};
+
+	std::string path;
+	for(std::size_t level = 0; level < m_spec.depth; level++)
+	{
+		auto folder = entry_hash(index, level + 1) % m_spec.fanout;
+		path += folders[folder % 8];
+		path += "_" + std::to_string(folder) + "/";
+	}
+
+	// the index keeps paths unique
+	path += "f" + std::to_string(index) + extensions[entry_hash(index, 0x100) % 5];
+	return path;
+}
+
+std::vector<uint8_t> ArchiveGenerator::entry_data(std::size_t index) const
+{
+	static const char *words[] = {"[section]\r\n", "visual = ", "actors\\stalker_", "cost = ", "0.5", "\r\n", "inv_weight = ", "true", "; comment\r\n"};
+
+	std::vector<uint8_t> data(entry_size(index));
+
+	uint64_t state = entry_hash(index, 0x200);
+	for(std::size_t pos = 0; pos < data.size();)
+	{
+		state = Mix(state);
+
+		// now and then a digit breaks the repetition, like numbers in real configs do
+		if(state % 5 == 0)
+		{
+			data[pos++] = static_cast<uint8_t>('0' + (state >> 8) % 10);
+			continue;
+		}
+
+		const char *word = words[(state >> 16) % 9];
+		for(; *word && pos < data.size(); word++)
+		{
+			data[pos++] = static_cast<uint8_t>(*word);
+		}
+	}
+
+	return data;
+}
+
+uint64_t ArchiveGenerator::entry_hash(std::size_t index, uint64_t salt) const
+{
+	return Mix(Mix(m_spec.seed ^ (salt << 48)) ^ index);
+}
+
+std::size_t ArchiveGenerator::entry_size(std::size_t index) const
+{
+	auto unit = static_cast<double>(entry_hash(index, 0x300) >> 11) / static_cast<double>(1ull << 53);
+	auto size = std::exp(std::log(static_cast<double>(m_spec.min_size)) + unit * std::log(static_cast<double>(m_spec.max_size) / m_spec.min_size));
+
+	return std::clamp(static_cast<std::size_t>(size), m_spec.min_size, m_spec.max_size);
+}
+
+void ArchiveGenerator::write_header(xr_writer& w, const std::vector<uint8_t>& header) const
+{
+	uint8_t *data = nullptr;
+	uint32_t size = 0;
+	xr_lzhuf::compress(data, size, header.data(), static_cast<uint32_t>(header.size()));
+
+	if(m_spec.version == DBVersion::DB_VERSION_2947RU || m_spec.version == DBVersion::DB_VERSION_2947WW)
+	{
+		xr_scrambler scrambler(m_spec.version == DBVersion::DB_VERSION_2947RU ? xr_scrambler::CC_RU : xr_scrambler::CC_WW);
+		scrambler.encrypt(data, data, size);
+	}
+
+	w.open_chunk(DB_CHUNK_HEADER | CHUNK_COMPRESSED);
+	w.w_raw(data, size);
+	w.close_chunk();
+
+	free(data);
+}
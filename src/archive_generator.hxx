@@ -0,0 +1,50 @@
+#pragma once
+
+#include "xray_re/xr_types.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xray_re
+{
+	class xr_writer;
+};
+
+// Shape of a synthetic archive. Entry sizes are log-uniform between min_size and max_size,
+// content is config-like text, so compression has something to do.
+struct ArchiveSpec
+{
+	xray_re::DBVersion version{xray_re::DBVersion::DB_VERSION_XDB};
+	std::size_t entries{1000};
+	std::size_t min_size{64};
+	std::size_t max_size{64 * 1024};
+	std::size_t depth{3};   // folder levels above the files
+	std::size_t fanout{8};  // subfolders of every folder
+	bool compress{false};   // LZHUF for 1114 entries, LZO1X for the other formats
+	uint64_t seed{0};
+};
+
+// Writes valid archives of every DBVersion, including the formats Packer can't produce
+// (1114, 2215, 2945). Every entry is derived from its index alone, so archives of millions
+// of entries are streamed to disk and any entry can be regenerated to check extracted files.
+class ArchiveGenerator
+{
+public:
+	explicit ArchiveGenerator(const ArchiveSpec& spec);
+
+	bool write(const std::string& path) const;
+
+	// '/' separated path and content of the entry with the given index
+	std::string entry_path(std::size_t index) const;
+	std::vector<uint8_t> entry_data(std::size_t index) const;
+
+private:
+	uint64_t entry_hash(std::size_t index, uint64_t salt) const;
+	std::size_t entry_size(std::size_t index) const;
+
+	void write_header(xray_re::xr_writer& w, const std::vector<uint8_t>& header) const;
+
+	ArchiveSpec m_spec;
+};
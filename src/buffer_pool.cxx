@@ -0,0 +1,115 @@
+#include "buffer_pool.hxx"
+
+#include <cstdlib>
+
+std::atomic<std::size_t> BufferPool::s_held{0};
+std::atomic<std::size_t> BufferPool::s_peak{0};
+
+BufferPool::~BufferPool()
+{
+	for(std::size_t i = 0; i < m_free.size(); i++)
+	{
+		for(auto data : m_free[i])
+		{
+			free(data);
+			freed(std::size_t(1) << (i + MIN_CLASS_BITS));
+		}
+	}
+}
+
+BufferPool::Buffer BufferPool::acquire(std::size_t size)
+{
+	Buffer buffer;
+
+	auto index = size_class(size);
+	if(index < CLASS_COUNT)
+	{
+		buffer.capacity = std::size_t(1) << (index + MIN_CLASS_BITS);
+
+		auto& free_list = m_free[index];
+		if(!free_list.empty())
+		{
+			buffer.data = free_list.back();
+			free_list.pop_back();
+			return buffer;
+		}
+	}
+	else
+	{
+		buffer.capacity = size;
+	}
+
+	buffer.data = static_cast<uint8_t*>(malloc(buffer.capacity));
+	if(buffer.data)
+	{
+		allocated(buffer.capacity);
+	}
+	else
+	{
+		buffer.capacity = 0;
+	}
+
+	return buffer;
+}
+
+void BufferPool::release(Buffer& buffer)
+{
+	if(!buffer.data)
+	{
+		return;
+	}
+
+	auto index = size_class(buffer.capacity);
+	if(index < CLASS_COUNT && m_free[index].size() < MAX_FREE_PER_CLASS)
+	{
+		m_free[index].push_back(buffer.data);
+	}
+	else
+	{
+		free(buffer.data);
+		freed(buffer.capacity);
+	}
+
+	buffer = Buffer();
+}
+
+BufferPool& BufferPool::local()
+{
+	thread_local BufferPool pool;
+	return pool;
+}
+
+std::size_t BufferPool::peak()
+{
+	return s_peak;
+}
+
+void BufferPool::reset_peak()
+{
+	s_peak = s_held.load();
+}
+
+std::size_t BufferPool::size_class(std::size_t size)
+{
+	std::size_t index = 0;
+	while(index < CLASS_COUNT && (std::size_t(1) << (index + MIN_CLASS_BITS)) < size)
+	{
+		index++;
+	}
+
+	return index;
+}
+
+void BufferPool::allocated(std::size_t size)
+{
+	auto held = s_held += size;
+	auto peak = s_peak.load();
+	while(held > peak && !s_peak.compare_exchange_weak(peak, held))
+	{
+	}
+}
+
+void BufferPool::freed(std::size_t size)
+{
+	s_held -= size;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decompression buffers rounded up to power of two size classes. Released buffers are kept
+// for the next entries of about the same size instead of going back to the allocator, so
+// memory that is already faulted in keeps being reused. Every thread has its own pool and
+// a buffer has to be released on the thread that acquired it.
+class BufferPool
+{
+public:
+	enum
+	{
+		MIN_CLASS_BITS = 12,   // 4 KiB
+		CLASS_COUNT = 15,      // up to 64 MiB, bigger buffers are not kept
+		MAX_FREE_PER_CLASS = 2
+	};
+
+	struct Buffer
+	{
+		uint8_t *data{nullptr};
+		std::size_t capacity{0};
+	};
+
+	BufferPool() = default;
+	~BufferPool();
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	// nullptr data if the memory can't be allocated
+	Buffer acquire(std::size_t size);
+	void release(Buffer& buffer);
+
+	// pool of the calling thread
+	static BufferPool& local();
+
+	// the most memory all pools held at once (used and kept for reuse) since the last reset
+	static std::size_t peak();
+	static void reset_peak();
+
+private:
+	static std::size_t size_class(std::size_t size);
+
+	static void allocated(std::size_t size);
+	static void freed(std::size_t size);
+
+	std::array<std::vector<uint8_t*>, CLASS_COUNT> m_free;
+
+	static std::atomic<std::size_t> s_held;
+	static std::atomic<std::size_t> s_peak;
+};
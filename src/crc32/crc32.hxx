@@ -3,3 +3,6 @@
 #include <cstddef>
 
 unsigned int crc32(const void *buf, std::size_t size);
+
+// continues crc of the preceding data, crc32(0, buf, size) == crc32(buf, size)
+unsigned int crc32(unsigned int crc, const void *buf, std::size_t size);
@@ -0,0 +1,157 @@
+#include "db_archive.hxx"
+#include "lzo_codec.hxx"
+#include "unpacker.hxx"
+#include "xray_re/xr_file_system.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using namespace xray_re;
+
+DBArchive::~DBArchive()
+{
+	close();
+}
+
+bool DBArchive::open(const std::string& path, const DBVersion& version)
+{
+	close();
+
+	if(version != DBVersion::DB_VERSION_2945 && version != DBVersion::DB_VERSION_2947RU &&
+	   version != DBVersion::DB_VERSION_2947WW && version != DBVersion::DB_VERSION_XDB)
+	{
+		spdlog::error("Random access is only supported for 2945, 2947 and XDB archives");
+		return false;
+	}
+
+	if(!xr_file_system::file_exist(path))
+	{
+		spdlog::error("File \"{}\" doesn't exist", path);
+		return false;
+	}
+
+	m_reader = xr_file_system::r_open(path);
+	if(!m_reader)
+	{
+		spdlog::error("Can't load {}", path);
+		return false;
+	}
+
+	if(!Unpacker::read_files(path, m_reader, version, m_entries))
+	{
+		spdlog::error("Failed to read header of {}", path);
+		close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(m_reader->data());
+	m_size = m_reader->size();
+
+	// keys must not move once they are in the map, so the whole arena is built first
+	m_keys = normalize(m_entries.paths());
+
+	std::string_view keys(m_keys);
+	m_index.reserve(m_entries.size());
+	for(std::size_t i = 0; i < m_entries.size(); i++)
+	{
+		if(!m_entries.is_folder(i))
+		{
+			m_index.emplace(keys.substr(m_entries.path_offset(i), m_entries.path(i).size()), i);
+		}
+	}
+
+	return true;
+}
+
+void DBArchive::close()
+{
+	if(m_reader)
+	{
+		xr_file_system::r_close(m_reader);
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+	m_index.clear();
+	m_keys.clear();
+	m_entries.clear();
+}
+
+bool DBArchive::is_open() const
+{
+	return m_reader != nullptr;
+}
+
+const EntryTable& DBArchive::entries() const
+{
+	return m_entries;
+}
+
+std::size_t DBArchive::lookup(std::string_view path) const
+{
+	auto it = m_index.find(normalize(path));
+	return it == m_index.end() ? npos : it->second;
+}
+
+bool DBArchive::read_into(std::size_t entry, uint8_t *buffer, std::size_t buffer_size) const
+{
+	if(!is_in_bounds(entry) || buffer_size < m_entries.size_real(entry))
+	{
+		return false;
+	}
+
+	auto src = m_data + m_entries.offset(entry);
+	if(!m_entries.is_compressed(entry))
+	{
+		std::memcpy(buffer, src, m_entries.size_real(entry));
+		return true;
+	}
+
+	return LZOCodec::decompress(buffer, m_entries.size_real(entry), src, m_entries.size_compressed(entry));
+}
+
+bool DBArchive::read_into(std::size_t entry, std::vector<uint8_t>& buffer) const
+{
+	if(entry >= m_entries.size())
+	{
+		return false;
+	}
+
+	buffer.resize(m_entries.size_real(entry));
+	return read_into(entry, buffer.data(), buffer.size());
+}
+
+const uint8_t* DBArchive::view(std::size_t entry) const
+{
+	if(!is_in_bounds(entry) || m_entries.is_compressed(entry))
+	{
+		return nullptr;
+	}
+
+	return m_data + m_entries.offset(entry);
+}
+
+std::string DBArchive::normalize(std::string_view path)
+{
+	std::string result(path);
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c)
+	{
+		return c == '\\' ? '/' : static_cast<char>(std::tolower(c));
+	});
+
+	return result;
+}
+
+bool DBArchive::is_in_bounds(std::size_t entry) const
+{
+	if(entry >= m_entries.size() || m_entries.is_folder(entry))
+	{
+		return false;
+	}
+
+	auto offset = m_entries.offset(entry);
+	return offset <= m_size && m_entries.size_compressed(entry) <= m_size - offset;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "entry_table.hxx"
+#include "xray_re/xr_types.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xray_re
+{
+	class xr_reader;
+};
+
+// Random access to the files of a 2945/2947/XDB archive. The archive is mapped once and
+// the header is parsed once, after that every file can be found and read independently.
+// All const methods are safe to call from several threads.
+class DBArchive
+{
+public:
+	DBArchive() = default;
+	~DBArchive();
+
+	DBArchive(const DBArchive&) = delete;
+	DBArchive& operator=(const DBArchive&) = delete;
+
+	bool open(const std::string& path, const xray_re::DBVersion& version);
+	void close();
+	bool is_open() const;
+
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	const EntryTable& entries() const;
+
+	// Paths are matched case-insensitively, both '/' and '\' work as separators.
+	// Returns the entry index, or npos for unknown paths and folders.
+	std::size_t lookup(std::string_view path) const;
+
+	// Unpacks the entry into buffer, which must hold at least size_real bytes
+	bool read_into(std::size_t entry, uint8_t *buffer, std::size_t buffer_size) const;
+	bool read_into(std::size_t entry, std::vector<uint8_t>& buffer) const;
+
+	// Contents of a stored (not compressed) entry right in the archive mapping, nullptr otherwise.
+	// The pointer is valid until the archive is closed.
+	const uint8_t* view(std::size_t entry) const;
+
+private:
+	static std::string normalize(std::string_view path);
+
+	bool is_in_bounds(std::size_t entry) const;
+
+	xray_re::xr_reader *m_reader{nullptr};
+	const uint8_t *m_data{nullptr};
+	std::size_t m_size{0};
+
+	EntryTable m_entries;
+
+	// normalized paths of all entries, hash keys point into it
+	std::string m_keys;
+	std::unordered_map<std::string_view, std::size_t> m_index;
+};
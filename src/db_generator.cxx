@@ -0,0 +1,103 @@
+#include "archive_generator.hxx"
+
+#include <boost/program_options.hpp>
+#include <spdlog/spdlog.h>
+
+#include <sstream>
+
+using namespace xray_re;
+using namespace boost::program_options;
+
+int main(int argc, char *argv[])
+{
+	try
+	{
+		unsigned int line_lenght = 82;
+		options_description options("Options", line_lenght);
+		options.add_options()
+		    ("help", "produce help message")
+		    ("out", value<std::string>()->value_name("<FILE>"), "archive to create")
+		    ("entries", value<std::size_t>()->value_name("<N>")->default_value(1000), "number of files")
+		    ("min_size", value<std::size_t>()->value_name("<BYTES>")->default_value(64), "smallest file size")
+		    ("max_size", value<std::size_t>()->value_name("<BYTES>")->default_value(64 * 1024), "largest file size")
+		    ("depth", value<std::size_t>()->value_name("<N>")->default_value(3), "folder levels above the files")
+		    ("fanout", value<std::size_t>()->value_name("<N>")->default_value(8), "subfolders of every folder")
+		    ("seed", value<uint64_t>()->value_name("<N>")->default_value(0), "seed of paths, sizes and contents")
+		    ("compress", "compress files (LZHUF for 11xx, LZO1X for the other formats)")
+		    ("11xx", "1114/1154 archive format")
+		    ("2215", "2215 archive format")
+		    ("2945", "2945/2939 archive format")
+		    ("2947ru", "release version format")
+		    ("2947ww", "worldwide release version and 3120 format")
+		    ("xdb", "xdb archive format");
+
+		variables_map vm;
+		store(parse_command_line(argc, argv, options), vm);
+		notify(vm);
+
+		if(vm.count("help") || !vm.count("out"))
+		{
+			spdlog::info("Usage example:");
+			spdlog::info("  db_generator --out ~/synthetic.db --2947ru --entries 1000000 --compress");
+			std::stringstream options_string;
+			options_string << options;
+			spdlog::info(options_string.str());
+
+			return 1;
+		}
+
+		std::vector<std::pair<std::string, DBVersion>> db_versions =
+		{
+			{"xdb",    DBVersion::DB_VERSION_XDB},
+			{"2947ru", DBVersion::DB_VERSION_2947RU},
+			{"2947ww", DBVersion::DB_VERSION_2947WW},
+			{"11xx",   DBVersion::DB_VERSION_1114},
+			{"2215",   DBVersion::DB_VERSION_2215},
+			{"2945",   DBVersion::DB_VERSION_2945}
+		};
+
+		ArchiveSpec spec;
+		spec.version = DBVersion::DB_VERSION_AUTO;
+
+		for(const auto& db_version : db_versions)
+		{
+			if(vm.count(db_version.first))
+			{
+				if(spec.version != DBVersion::DB_VERSION_AUTO)
+				{
+					spdlog::error("More than one archive format specified");
+					return 1;
+				}
+
+				spec.version = db_version.second;
+			}
+		}
+
+		spec.entries = vm["entries"].as<std::size_t>();
+		spec.min_size = vm["min_size"].as<std::size_t>();
+		spec.max_size = vm["max_size"].as<std::size_t>();
+		spec.depth = vm["depth"].as<std::size_t>();
+		spec.fanout = vm["fanout"].as<std::size_t>();
+		spec.seed = vm["seed"].as<uint64_t>();
+		spec.compress = vm.count("compress") != 0;
+
+		auto path = vm["out"].as<std::string>();
+		if(!ArchiveGenerator(spec).write(path))
+		{
+			return 1;
+		}
+
+		spdlog::info("Generated {} files in {}", spec.entries, path);
+		return 0;
+	}
+	catch(boost::program_options::error& e)
+	{
+		spdlog::error(e.what());
+	}
+	catch(std::exception& e)
+	{
+		spdlog::critical("Exception: {}", e.what());
+	}
+
+	return 1;
+}
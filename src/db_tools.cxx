@@ -1,23 +1,86 @@
 #include "db_tools.hxx"
+#include "index_cache.hxx"
+#include "lister.hxx"
 #include "packer.hxx"
+#include "progress.hxx"
 #include "unpacker.hxx"
+#include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_metrics.hxx"
 
 #include <spdlog/spdlog.h>
 
+#include <chrono>
+
 using namespace xray_re;
 
 bool m_debug = false;
+std::string m_metrics_json;
+
+// collects stage metrics of one operation and reports them when it goes out of scope
+class MetricsScope
+{
+public:
+	explicit MetricsScope(const char *operation) : m_operation(operation), m_start(std::chrono::steady_clock::now())
+	{
+		xr_metrics::reset();
+	}
+
+	~MetricsScope()
+	{
+		if(!xr_metrics::is_enabled())
+		{
+			return;
+		}
+
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		xr_metrics::log_summary(m_operation, seconds);
+
+		if(!m_metrics_json.empty() && xr_metrics::save_json(m_metrics_json, m_operation, seconds))
+		{
+			spdlog::info("Metrics saved to {}", m_metrics_json);
+		}
+	}
+
+private:
+	const char *m_operation;
+	std::chrono::steady_clock::time_point m_start;
+};
 
-void DBTools::pack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only)
+bool DBTools::pack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only, std::size_t jobs, xray_re::CompressionLevel compression, bool zero_copy)
 {
+	MetricsScope metrics("pack");
 	Packer packer;
-	packer.process(source_path, destination_path, version, xdb_ud, is_read_only);
+	return packer.process(source_path, destination_path, version, xdb_ud, is_read_only, jobs, compression, zero_copy);
 }
 
-void DBTools::unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& filter, bool is_read_only)
+void DBTools::unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& filter, bool is_read_only, std::size_t jobs)
 {
+	PathFilter path_filter;
+	if(!filter.empty() && !path_filter.include(filter))
+	{
+		return;
+	}
+
+	unpack(source_path, destination_path, version, path_filter, is_read_only, jobs);
+}
+
+void DBTools::unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const PathFilter& filter, bool is_read_only, std::size_t jobs)
+{
+	MetricsScope metrics("unpack");
 	Unpacker unpacker;
-	unpacker.process(source_path, destination_path, version, filter, is_read_only);
+	unpacker.process(source_path, destination_path, version, filter, is_read_only, jobs);
+}
+
+bool DBTools::verify(const std::string& source_path, const xray_re::DBVersion& version, std::size_t jobs)
+{
+	MetricsScope metrics("verify");
+	return Unpacker::verify(source_path, version, jobs);
+}
+
+bool DBTools::list(const std::string& source_path, const xray_re::DBVersion& version, ListFormat format)
+{
+	MetricsScope metrics("list");
+	return Lister::process(source_path, version, format);
 }
 
 void DBTools::set_debug(bool value)
@@ -28,3 +91,36 @@ void DBTools::set_debug(bool value)
 		spdlog::set_level(spdlog::level::debug);
 	}
 }
+
+void DBTools::set_write_buffer_size(std::size_t size)
+{
+	xr_file_system::instance().set_write_buffer_size(size);
+}
+
+void DBTools::set_io_uring(bool value)
+{
+	xr_file_system::instance().set_use_io_uring(value);
+}
+
+void DBTools::set_verbose(bool value)
+{
+	Progress::set_verbose(value);
+}
+
+void DBTools::set_index_cache(const std::string& path)
+{
+	auto directory = path.empty() ? IndexCache::default_directory() : path;
+	if(directory.empty())
+	{
+		spdlog::warn("Can't find a folder for the index cache");
+		return;
+	}
+
+	IndexCache::set_directory(directory);
+}
+
+void DBTools::set_metrics(bool value, const std::string& json_path)
+{
+	xr_metrics::set_enabled(value);
+	m_metrics_json = value ? json_path : "";
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lister.hxx"
+#include "path_filter.hxx"
 #include "xray_re/xr_types.hxx"
 
 #include <string>
@@ -8,8 +10,23 @@
 class DBTools
 {
 public:
-	static void pack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only);
-	static void unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& filter, bool is_read_only);
+	static bool pack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only, std::size_t jobs = 1, xray_re::CompressionLevel compression = xray_re::CompressionLevel::NONE, bool zero_copy = false);
+	// filter is a single pattern in PathFilter syntax, an empty one extracts everything
+	static void unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& filter, bool is_read_only, std::size_t jobs = 1);
+	static void unpack(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const PathFilter& filter, bool is_read_only, std::size_t jobs = 1);
+	static bool verify(const std::string& source_path, const xray_re::DBVersion& version, std::size_t jobs = 1);
+	static bool list(const std::string& source_path, const xray_re::DBVersion& version, ListFormat format);
 
 	static void set_debug(bool value);
+	static void set_write_buffer_size(std::size_t size);
+	static void set_io_uring(bool value);
+	// log every packed or extracted file (through an asynchronous logger), not only the progress
+	static void set_verbose(bool value);
+
+	// enables the header index cache in the given folder, an empty path selects the default one
+	static void set_index_cache(const std::string& path);
+
+	// time every stage of pack, unpack and verify and log a summary at the end,
+	// a non-empty json_path also saves the numbers there
+	static void set_metrics(bool value, const std::string& json_path = "");
 };
@@ -0,0 +1,40 @@
+#include "entry_table.hxx"
+
+#include <algorithm>
+
+void EntryTable::reserve(std::size_t count, std::size_t path_bytes)
+{
+	m_offsets.reserve(count);
+	m_sizes_real.reserve(count);
+	m_sizes_compressed.reserve(count);
+	m_crcs.reserve(count);
+	m_path_ends.reserve(count);
+	m_paths.reserve(path_bytes);
+}
+
+void EntryTable::clear()
+{
+	m_offsets.clear();
+	m_sizes_real.clear();
+	m_sizes_compressed.clear();
+	m_crcs.clear();
+	m_path_ends.clear();
+	m_paths.clear();
+}
+
+std::size_t EntryTable::add(std::string_view path, uint32_t offset, uint32_t size_real, uint32_t size_compressed, uint32_t crc)
+{
+	m_paths.append(path);
+	m_path_ends.push_back(static_cast<uint32_t>(m_paths.size()));
+	m_offsets.push_back(offset);
+	m_sizes_real.push_back(size_real);
+	m_sizes_compressed.push_back(size_compressed);
+	m_crcs.push_back(crc);
+
+	return m_offsets.size() - 1;
+}
+
+void EntryTable::replace_in_paths(char from, char to)
+{
+	std::replace(m_paths.begin(), m_paths.end(), from, to);
+}
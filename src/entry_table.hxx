@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Archive entries stored column by column, with all paths packed into one string.
+// Folders are entries with zero offset, like in the archive header itself.
+class EntryTable
+{
+public:
+	void reserve(std::size_t count, std::size_t path_bytes = 0);
+	void clear();
+
+	std::size_t add(std::string_view path, uint32_t offset, uint32_t size_real, uint32_t size_compressed, uint32_t crc);
+
+	// replaces a character in all the paths at once, e.g. to switch path separators
+	void replace_in_paths(char from, char to);
+
+	std::size_t size() const;
+	bool empty() const;
+
+	std::string_view path(std::size_t i) const;
+	uint32_t offset(std::size_t i) const;
+	uint32_t size_real(std::size_t i) const;
+	uint32_t size_compressed(std::size_t i) const;
+	uint32_t crc(std::size_t i) const;
+
+	bool is_folder(std::size_t i) const;
+	bool is_compressed(std::size_t i) const;
+
+	// all paths one after another, path(i) starts at path_offset(i)
+	const std::string& paths() const;
+	uint32_t path_offset(std::size_t i) const;
+
+private:
+	std::vector<uint32_t> m_offsets;
+	std::vector<uint32_t> m_sizes_real;
+	std::vector<uint32_t> m_sizes_compressed;
+	std::vector<uint32_t> m_crcs;
+	std::vector<uint32_t> m_path_ends;
+	std::string m_paths;
+};
+
+inline std::size_t EntryTable::size() const { return m_offsets.size(); }
+inline bool EntryTable::empty() const { return m_offsets.empty(); }
+inline uint32_t EntryTable::path_offset(std::size_t i) const { return i == 0 ? 0 : m_path_ends[i - 1]; }
+inline std::string_view EntryTable::path(std::size_t i) const { return std::string_view(m_paths).substr(path_offset(i), m_path_ends[i] - path_offset(i)); }
+inline uint32_t EntryTable::offset(std::size_t i) const { return m_offsets[i]; }
+inline uint32_t EntryTable::size_real(std::size_t i) const { return m_sizes_real[i]; }
+inline uint32_t EntryTable::size_compressed(std::size_t i) const { return m_sizes_compressed[i]; }
+inline uint32_t EntryTable::crc(std::size_t i) const { return m_crcs[i]; }
+inline bool EntryTable::is_folder(std::size_t i) const { return m_offsets[i] == 0; }
+inline bool EntryTable::is_compressed(std::size_t i) const { return m_sizes_real[i] != m_sizes_compressed[i]; }
+inline const std::string& EntryTable::paths() const { return m_paths; }
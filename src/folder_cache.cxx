@@ -0,0 +1,74 @@
+#include "folder_cache.hxx"
+#include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_metrics.hxx"
+
+#include <mutex>
+
+using namespace xray_re;
+
+bool FolderCache::create(xr_file_system& fs, std::string_view path)
+{
+	path = trim(path);
+	if(path.empty() || contains(path))
+	{
+		return true;
+	}
+
+	std::unique_lock lock(m_mutex);
+	if(m_folders.find(std::string(path)) != m_folders.end())
+	{
+		return true;
+	}
+
+	xr_metrics::scoped_timer timer(xr_metrics::CREATE_FOLDER);
+	if(!fs.create_path(std::string(path)))
+	{
+		return false;
+	}
+
+	// create_path made the parents as well, so they never have to be checked again
+	for(auto folder = path; !folder.empty(); folder = parent(folder))
+	{
+		if(!m_folders.emplace(folder).second)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool FolderCache::contains(std::string_view path) const
+{
+	std::shared_lock lock(m_mutex);
+	return m_folders.find(std::string(trim(path))) != m_folders.end();
+}
+
+void FolderCache::clear()
+{
+	std::unique_lock lock(m_mutex);
+	m_folders.clear();
+}
+
+std::size_t FolderCache::size() const
+{
+	std::shared_lock lock(m_mutex);
+	return m_folders.size();
+}
+
+std::string_view FolderCache::parent(std::string_view path)
+{
+	path = trim(path);
+	auto separator = path.rfind('/');
+	return separator == std::string_view::npos ? std::string_view() : trim(path.substr(0, separator));
+}
+
+std::string_view FolderCache::trim(std::string_view path)
+{
+	while(path.size() > 1 && path.back() == '/')
+	{
+		path.remove_suffix(1);
+	}
+
+	return path;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace xray_re
+{
+	class xr_file_system;
+};
+
+// Remembers the folders created during extraction, so every folder costs filesystem
+// calls only once no matter how many files are written into it. Safe to use from
+// several threads, though lookups are cheapest when the tree is created up front.
+class FolderCache
+{
+public:
+	// creates the folder with all its parents unless it was already done through this cache
+	bool create(xray_re::xr_file_system& fs, std::string_view path);
+	bool contains(std::string_view path) const;
+	void clear();
+
+	std::size_t size() const;
+
+	// "a/b/c.ltx" -> "a/b", empty for a path without folders
+	static std::string_view parent(std::string_view path);
+
+private:
+	static std::string_view trim(std::string_view path);
+
+	mutable std::shared_mutex m_mutex;
+	std::unordered_set<std::string> m_folders;
+};
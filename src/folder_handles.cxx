@@ -0,0 +1,61 @@
+#include "folder_handles.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+FolderHandles::FolderHandles(std::size_t capacity) : m_capacity(std::max<std::size_t>(capacity, 1)) {}
+
+FolderHandles::Handle FolderHandles::open(const std::string& path)
+{
+	std::lock_guard lock(m_mutex);
+
+	auto it = m_index.find(path);
+	if(it != m_index.end())
+	{
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return it->second->second;
+	}
+
+	// O_PATH is enough to be used as a base of openat and doesn't need read permission
+	auto fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if(fd == -1)
+	{
+		spdlog::debug("Failed to open folder {}: {} (errno={}) ", path, strerror(errno), errno);
+		return nullptr;
+	}
+
+	Handle handle(new int(fd), [](const int *fd)
+	{
+		::close(*fd);
+		delete fd;
+	});
+
+	if(m_entries.size() >= m_capacity)
+	{
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+
+	m_entries.emplace_front(path, handle);
+	m_index.emplace(path, m_entries.begin());
+
+	return handle;
+}
+
+void FolderHandles::clear()
+{
+	std::lock_guard lock(m_mutex);
+	m_index.clear();
+	m_entries.clear();
+}
+
+std::size_t FolderHandles::size() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_entries.size();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Bounded cache of open folder descriptors, so extracted files can be opened with
+// openat(folder, name) instead of resolving the whole path again for every file.
+// Least recently used folders are dropped first; a descriptor is closed only after
+// the last holder of its handle lets it go, so eviction never pulls it from under a writer.
+class FolderHandles
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 128
+	};
+
+	using Handle = std::shared_ptr<const int>;
+
+	explicit FolderHandles(std::size_t capacity = DEFAULT_CAPACITY);
+
+	FolderHandles(const FolderHandles&) = delete;
+	FolderHandles& operator=(const FolderHandles&) = delete;
+
+	// descriptor of an existing folder, nullptr if it can't be opened
+	Handle open(const std::string& path);
+	void clear();
+
+	std::size_t size() const;
+
+private:
+	using Entry = std::pair<std::string, Handle>;
+
+	mutable std::mutex m_mutex;
+	std::size_t m_capacity;
+	std::list<Entry> m_entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+};
@@ -0,0 +1,227 @@
+#include "index_cache.hxx"
+#include "crc32/crc32.hxx"
+#include "xray_re/xr_file_system.hxx"
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace xray_re;
+
+// Index file layout, little-endian without padding:
+//   u32 magic, u32 layout version
+//   u64 archive size, u64 archive mtime (ns), u32 header crc, u32 db version
+//   u32 archive path length, archive path
+//   u32 entry count, u32 path arena size
+//   entry count x { u32 offset, u32 size_real, u32 size_compressed, u32 crc, u32 path offset, u32 path length }
+//   path arena
+constexpr uint32_t INDEX_MAGIC = 0x58494244; // "DBIX"
+constexpr uint32_t INDEX_LAYOUT_VERSION = 1;
+
+static std::string s_directory;
+
+void IndexCache::set_directory(const std::string& path)
+{
+	s_directory = path;
+	if(!s_directory.empty())
+	{
+		xr_file_system::append_path_separator(s_directory);
+	}
+}
+
+const std::string& IndexCache::directory()
+{
+	return s_directory;
+}
+
+bool IndexCache::is_enabled()
+{
+	return !s_directory.empty();
+}
+
+std::string IndexCache::default_directory()
+{
+	if(auto cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home)
+	{
+		return std::string(cache_home) + "/db_converter/";
+	}
+
+	if(auto home = std::getenv("HOME"); home && *home)
+	{
+		return std::string(home) + "/.cache/db_converter/";
+	}
+
+	return {};
+}
+
+bool IndexCache::make_key(const std::string& archive_path, Key& key)
+{
+	struct stat st{};
+	if(stat(archive_path.c_str(), &st) != 0)
+	{
+		return false;
+	}
+
+	std::error_code error;
+	auto path = std::filesystem::weakly_canonical(archive_path, error);
+	key.path = error ? archive_path : path.string();
+	key.size = static_cast<uint64_t>(st.st_size);
+	key.mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+
+	return true;
+}
+
+std::string IndexCache::index_path(const Key& key)
+{
+	// the full path is stored inside, so a hash collision only costs a cache miss
+	return fmt::format("{}{:08x}.idx", s_directory, crc32(key.path.data(), key.path.size()));
+}
+
+bool IndexCache::load(const std::string& archive_path, DBVersion version, uint32_t header_crc, EntryTable& entries)
+{
+	Key key;
+	if(!is_enabled() || !make_key(archive_path, key))
+	{
+		return false;
+	}
+
+	auto path = index_path(key);
+	if(!xr_file_system::file_exist(path))
+	{
+		return false;
+	}
+
+	auto reader = xr_file_system::r_open(path);
+	if(!reader)
+	{
+		return false;
+	}
+
+	auto fits = [&reader](std::size_t size) { return reader->elapsed() >= size; };
+
+	bool is_valid = fits(36) &&
+		reader->r_u32() == INDEX_MAGIC &&
+		reader->r_u32() == INDEX_LAYOUT_VERSION &&
+		reader->r<uint64_t>() == key.size &&
+		reader->r<uint64_t>() == key.mtime &&
+		reader->r_u32() == header_crc &&
+		reader->r_u32() == static_cast<uint32_t>(version);
+
+	if(is_valid)
+	{
+		auto path_length = reader->r_u32();
+		is_valid = fits(path_length) && std::string(reader->skip<char>(path_length), path_length) == key.path;
+	}
+
+	if(is_valid && fits(8))
+	{
+		auto count = reader->r_u32();
+		auto arena_size = reader->r_u32();
+
+		if(fits(std::size_t(count) * 24 + arena_size))
+		{
+			auto records = reader->skip<uint32_t>(std::size_t(count) * 6);
+			auto arena = reader->skip<char>(arena_size);
+
+			entries.clear();
+			entries.reserve(count, arena_size);
+
+			for(uint32_t i = 0; i < count && is_valid; i++)
+			{
+				auto entry = records + i * 6;
+				if(std::size_t(entry[4]) + entry[5] > arena_size)
+				{
+					is_valid = false;
+					break;
+				}
+
+				entries.add(std::string_view(arena + entry[4], entry[5]), entry[0], entry[1], entry[2], entry[3]);
+			}
+		}
+		else
+		{
+			is_valid = false;
+		}
+	}
+	else
+	{
+		is_valid = false;
+	}
+
+	xr_file_system::r_close(reader);
+
+	if(!is_valid)
+	{
+		spdlog::debug("Index cache {} is stale", path);
+		entries.clear();
+		return false;
+	}
+
+	spdlog::debug("Loaded {} entries of {} from index cache {}", entries.size(), archive_path, path);
+	return true;
+}
+
+void IndexCache::store(const std::string& archive_path, DBVersion version, uint32_t header_crc, const EntryTable& entries)
+{
+	xr_file_system& fs = xr_file_system::instance();
+
+	Key key;
+	if(!is_enabled() || fs.is_read_only() || !make_key(archive_path, key))
+	{
+		return;
+	}
+
+	xr_memory_writer w;
+	w.w_u32(INDEX_MAGIC);
+	w.w_u32(INDEX_LAYOUT_VERSION);
+	w.w<uint64_t>(key.size);
+	w.w<uint64_t>(key.mtime);
+	w.w_u32(header_crc);
+	w.w_u32(static_cast<uint32_t>(version));
+	w.w_u32(static_cast<uint32_t>(key.path.size()));
+	w.w_raw(key.path.data(), key.path.size());
+
+	const auto& arena = entries.paths();
+
+	w.w_u32(static_cast<uint32_t>(entries.size()));
+	w.w_u32(static_cast<uint32_t>(arena.size()));
+
+	for(std::size_t i = 0; i < entries.size(); i++)
+	{
+		w.w_u32(entries.offset(i));
+		w.w_u32(entries.size_real(i));
+		w.w_u32(entries.size_compressed(i));
+		w.w_u32(entries.crc(i));
+		w.w_u32(entries.path_offset(i));
+		w.w_u32(static_cast<uint32_t>(entries.path(i).size()));
+	}
+
+	w.w_raw(arena.data(), arena.size());
+
+	// write to a temporary file first, so concurrent readers never see a partial index
+	auto path = index_path(key);
+	auto temp_path = fmt::format("{}.{}.tmp", path, getpid());
+
+	try
+	{
+		if(!fs.create_path(s_directory) || !w.save_to(temp_path) || std::rename(temp_path.c_str(), path.c_str()) != 0)
+		{
+			spdlog::warn("Failed to write index cache {}", path);
+			std::remove(temp_path.c_str());
+			return;
+		}
+	}
+	catch(const std::exception& e)
+	{
+		spdlog::warn("Failed to write index cache {}: {}", path, e.what());
+		std::remove(temp_path.c_str());
+		return;
+	}
+
+	spdlog::debug("Stored {} entries of {} in index cache {}", entries.size(), archive_path, path);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "entry_table.hxx"
+#include "xray_re/xr_types.hxx"
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of parsed archive headers. An entry is keyed by the archive path, size, mtime,
+// format and crc of the raw (still compressed and scrambled) header chunk, so a hit skips
+// descrambling, LZHUF decoding and record parsing. Disabled while no directory is set.
+class IndexCache
+{
+public:
+	static void set_directory(const std::string& path);
+	static const std::string& directory();
+	static bool is_enabled();
+
+	static bool load(const std::string& archive_path, xray_re::DBVersion version, uint32_t header_crc, EntryTable& entries);
+	static void store(const std::string& archive_path, xray_re::DBVersion version, uint32_t header_crc, const EntryTable& entries);
+
+	// default location: $XDG_CACHE_HOME/db_converter or ~/.cache/db_converter
+	static std::string default_directory();
+
+private:
+	struct Key
+	{
+		std::string path;
+		uint64_t size{0};
+		uint64_t mtime{0};
+	};
+
+	static bool make_key(const std::string& archive_path, Key& key);
+	static std::string index_path(const Key& key);
+};
@@ -0,0 +1,223 @@
+#include "lister.hxx"
+#include "entry_table.hxx"
+#include "unpacker.hxx"
+#include "xray_re/xr_file_system.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <iterator>
+
+using namespace xray_re;
+
+// rows are collected up to this size before they are written
+constexpr std::size_t FLUSH_SIZE = 64 * 1024;
+
+static double Ratio(const EntryTable& entries, std::size_t i)
+{
+	return entries.size_real(i) == 0 ? 1.0 : static_cast<double>(entries.size_compressed(i)) / entries.size_real(i);
+}
+
+// upper half of CP1251, the code page of every archive path that isn't plain ASCII
+static const uint16_t CP1251_HIGH[64] =
+{
+	0x0402, 0x0403, 0x201a, 0x0453, 0x201e, 0x2026, 0x2020, 0x2021,
+	0x20ac, 0x2030, 0x0409, 0x2039, 0x040a, 0x040c, 0x040b, 0x040f,
+	0x0452, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+	0x0098, 0x2122, 0x0459, 0x203a, 0x045a, 0x045c, 0x045b, 0x045f,
+	0x00a0, 0x040e, 0x045e, 0x0408, 0x00a4, 0x0490, 0x00a6, 0x00a7,
+	0x0401, 0x00a9, 0x0404, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x0407,
+	0x00b0, 0x00b1, 0x0406, 0x0456, 0x0491, 0x00b5, 0x00b6, 0x00b7,
+	0x0451, 0x2116, 0x0454, 0x00bb, 0x0458, 0x0405, 0x0455, 0x0457,
+};
+
+static void AppendUtf8(fmt::memory_buffer& buffer, unsigned char c)
+{
+	// 0xc0-0xff is the contiguous Cyrillic block U+0410-U+044F
+	uint32_t code = c >= 0xc0 ? 0x0410 + (c - 0xc0) : CP1251_HIGH[c - 0x80];
+	if(code < 0x800)
+	{
+		buffer.push_back(static_cast<char>(0xc0 | (code >> 6)));
+	}
+	else
+	{
+		buffer.push_back(static_cast<char>(0xe0 | (code >> 12)));
+		buffer.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+	}
+	buffer.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+}
+
+// JSON must be UTF-8: header paths are transcoded from CP1251, host paths are taken as they are
+static void AppendJsonString(fmt::memory_buffer& buffer, std::string_view value, bool is_cp1251 = false)
+{
+	buffer.push_back('"');
+	for(auto c : value)
+	{
+		if(c == '"' || c == '\\')
+		{
+			buffer.push_back('\\');
+			buffer.push_back(c);
+		}
+		else if(static_cast<unsigned char>(c) < 0x20)
+		{
+			fmt::format_to(std::back_inserter(buffer), "\\u{:04x}", static_cast<unsigned int>(c));
+		}
+		else if(is_cp1251 && static_cast<unsigned char>(c) >= 0x80)
+		{
+			AppendUtf8(buffer, static_cast<unsigned char>(c));
+		}
+		else
+		{
+			buffer.push_back(c);
+		}
+	}
+	buffer.push_back('"');
+}
+
+static bool Flush(fmt::memory_buffer& buffer, std::FILE *out)
+{
+	auto size = buffer.size();
+	auto written = std::fwrite(buffer.data(), 1, size, out);
+	buffer.clear();
+	return written == size;
+}
+
+bool Lister::process(const std::string& source_path, const DBVersion& version, ListFormat format, std::FILE *out)
+{
+	if(version == DBVersion::DB_VERSION_AUTO)
+	{
+		spdlog::error("Unspecified DB format");
+		return false;
+	}
+
+	if(!xr_file_system::file_exist(source_path))
+	{
+		spdlog::error("File \"{}\" doesn't exist", source_path);
+		return false;
+	}
+
+	auto reader = xr_file_system::r_open(source_path);
+	if(!reader)
+	{
+		spdlog::error("Can't load {}", source_path);
+		return false;
+	}
+
+	EntryTable entries;
+	if(!Unpacker::read_files(source_path, reader, version, entries))
+	{
+		spdlog::error("Failed to read header of {}", source_path);
+		xr_file_system::r_close(reader);
+		return false;
+	}
+	xr_file_system::r_close(reader);
+
+	fmt::memory_buffer buffer;
+	auto it = std::back_inserter(buffer);
+
+	switch(format)
+	{
+		case ListFormat::TEXT:
+		{
+			fmt::format_to(it, "{:>10} {:>10} {:>10} {:>8} {:>6}  {}\n", "offset", "size", "packed", "crc", "ratio", "path");
+			break;
+		}
+		case ListFormat::TSV:
+		{
+			fmt::format_to(it, "path\toffset\tsize_real\tsize_compressed\tcrc\tratio\n");
+			break;
+		}
+		case ListFormat::JSON:
+		{
+			fmt::format_to(it, "{{\"archive\": ");
+			AppendJsonString(buffer, source_path);
+			fmt::format_to(it, ", \"entries\": [");
+			break;
+		}
+	}
+
+	std::size_t files = 0;
+	uint64_t size_real = 0;
+	uint64_t size_compressed = 0;
+
+	for(std::size_t i = 0; i < entries.size(); i++)
+	{
+		if(entries.is_folder(i))
+		{
+			continue;
+		}
+
+		auto path = entries.path(i);
+		switch(format)
+		{
+			case ListFormat::TEXT:
+			{
+				fmt::format_to(it, "{:>10} {:>10} {:>10} {:08x} {:>5.1f}%  {}\n", entries.offset(i), entries.size_real(i),
+					entries.size_compressed(i), entries.crc(i), 100.0 * Ratio(entries, i), path);
+				break;
+			}
+			case ListFormat::TSV:
+			{
+				fmt::format_to(it, "{}\t{}\t{}\t{}\t{:08x}\t{:.4f}\n", path, entries.offset(i), entries.size_real(i),
+					entries.size_compressed(i), entries.crc(i), Ratio(entries, i));
+				break;
+			}
+			case ListFormat::JSON:
+			{
+				fmt::format_to(it, "{}\n  {{\"path\": ", files == 0 ? "" : ",");
+				AppendJsonString(buffer, path, true);
+				fmt::format_to(it, ", \"offset\": {}, \"size_real\": {}, \"size_compressed\": {}, \"crc\": {}, \"ratio\": {:.4f}}}",
+					entries.offset(i), entries.size_real(i), entries.size_compressed(i), entries.crc(i), Ratio(entries, i));
+				break;
+			}
+		}
+
+		files++;
+		size_real += entries.size_real(i);
+		size_compressed += entries.size_compressed(i);
+
+		if(buffer.size() >= FLUSH_SIZE && !Flush(buffer, out))
+		{
+			spdlog::error("Failed to write the listing");
+			return false;
+		}
+	}
+
+	if(format == ListFormat::TEXT)
+	{
+		fmt::format_to(it, "{} files, {} bytes, {} packed\n", files, size_real, size_compressed);
+	}
+	else if(format == ListFormat::JSON)
+	{
+		fmt::format_to(it, "\n]}}\n");
+	}
+
+	if(!Flush(buffer, out) || std::fflush(out) != 0)
+	{
+		spdlog::error("Failed to write the listing");
+		return false;
+	}
+
+	return true;
+}
+
+bool Lister::parse_format(std::string_view name, ListFormat& format)
+{
+	if(name == "text")
+	{
+		format = ListFormat::TEXT;
+	}
+	else if(name == "tsv")
+	{
+		format = ListFormat::TSV;
+	}
+	else if(name == "json")
+	{
+		format = ListFormat::JSON;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
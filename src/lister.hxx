@@ -0,0 +1,26 @@
+#pragma once
+
+#include "xray_re/xr_types.hxx"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+enum class ListFormat
+{
+	TEXT,
+	TSV,
+	JSON
+};
+
+// Prints the entries of an archive straight from its decoded header. Rows are formatted into
+// one reused buffer that is written out whenever it fills up, so memory use doesn't depend
+// on the number of entries and nothing goes through the logger.
+class Lister
+{
+public:
+	static bool process(const std::string& source_path, const xray_re::DBVersion& version, ListFormat format, std::FILE *out = stdout);
+
+	// "text", "tsv" or "json", returns false for anything else
+	static bool parse_format(std::string_view name, ListFormat& format);
+};
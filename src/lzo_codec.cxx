@@ -0,0 +1,95 @@
+#include "lzo_codec.hxx"
+#include "xray_re/xr_metrics.hxx"
+
+#ifdef HAVE_LZO2
+#include <lzo/lzo1x.h>
+#else
+#include "lzo/minilzo.h"
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+using namespace xray_re;
+
+bool LZOCodec::init()
+{
+	if(lzo_init() != LZO_E_OK)
+	{
+		spdlog::error("Failed to initialize LZO");
+		return false;
+	}
+
+	return true;
+}
+
+bool LZOCodec::compress(std::vector<uint8_t>& dest, const uint8_t *src, std::size_t size, CompressionLevel level)
+{
+	if(level == CompressionLevel::NONE || size == 0)
+	{
+		return false;
+	}
+
+	xr_metrics::scoped_timer timer(xr_metrics::LZO_ENCODE, size);
+
+	// every thread compressing files needs its own dictionary
+#ifdef HAVE_LZO2
+	thread_local std::vector<uint8_t> work_memory(std::max(LZO1X_1_MEM_COMPRESS, LZO1X_999_MEM_COMPRESS));
+#else
+	thread_local std::vector<uint8_t> work_memory(LZO1X_1_MEM_COMPRESS);
+#endif
+
+	// worst case expansion of incompressible data, see LZO FAQ
+	dest.resize(size + size / 16 + 64 + 3);
+	lzo_uint size_compressed = dest.size();
+
+	int result;
+#ifdef HAVE_LZO2
+	if(level == CompressionLevel::MAX)
+	{
+		result = lzo1x_999_compress(src, size, dest.data(), &size_compressed, work_memory.data());
+	}
+	else
+#endif
+	{
+		result = lzo1x_1_compress(src, size, dest.data(), &size_compressed, work_memory.data());
+	}
+
+	if(result != LZO_E_OK)
+	{
+		spdlog::error("LZO compression failed with error {}", result);
+		return false;
+	}
+
+	// equal sizes mean "stored" for the unpacker
+	if(size_compressed >= size)
+	{
+		return false;
+	}
+
+	dest.resize(size_compressed);
+	return true;
+}
+
+bool LZOCodec::decompress(uint8_t *dest, std::size_t size_real, const uint8_t *src, std::size_t size_compressed)
+{
+	xr_metrics::scoped_timer timer(xr_metrics::LZO_DECODE, size_real);
+
+	lzo_uint size = size_real;
+	if(lzo1x_decompress_safe(src, size_compressed, dest, &size, nullptr) != LZO_E_OK)
+	{
+		return false;
+	}
+
+	return size == size_real;
+}
+
+bool LZOCodec::is_max_level_supported()
+{
+#ifdef HAVE_LZO2
+	return true;
+#else
+	return false;
+#endif
+}
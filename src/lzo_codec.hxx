@@ -0,0 +1,19 @@
+#pragma once
+
+#include "xray_re/xr_types.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LZOCodec
+{
+public:
+	static bool init();
+
+	// Returns false if the data can't be compressed or compression doesn't make it smaller
+	static bool compress(std::vector<uint8_t>& dest, const uint8_t *src, std::size_t size, xray_re::CompressionLevel level);
+	static bool decompress(uint8_t *dest, std::size_t size_real, const uint8_t *src, std::size_t size_compressed);
+
+	static bool is_max_level_supported();
+};
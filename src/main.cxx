@@ -4,6 +4,7 @@
 
 #include <boost/program_options.hpp>
 #include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 
 using namespace xray_re;
 using namespace boost::program_options;
@@ -12,7 +13,9 @@ enum class ToolsType
 {
 	AUTO   = 0x00,
 	UNPACK = 0x01,
-	PACK   = 0x02
+	PACK   = 0x02,
+	VERIFY = 0x03,
+	LIST   = 0x04
 };
 
 bool IsConflictingOptionsExist(const variables_map& vm, const std::vector<std::string>& options)
@@ -37,6 +40,46 @@ bool IsConflictingOptionsExist(const variables_map& vm, const std::vector<std::s
 	return false;
 }
 
+DBVersion ExtensionToDBVersion(const std::string& extension)
+{
+	if(is_xdb(extension) || is_db(extension))
+	{
+		spdlog::info("Auto-detected version: xdb");
+		return DBVersion::DB_VERSION_XDB;
+	}
+	else if(is_xrp(extension))
+	{
+		spdlog::info("Auto-detected version: 1114");
+		return DBVersion::DB_VERSION_1114;
+	}
+	else if(is_xp(extension))
+	{
+		spdlog::info("Auto-detected version: 2215");
+		return DBVersion::DB_VERSION_2215;
+	}
+
+	return DBVersion::DB_VERSION_AUTO;
+}
+
+// version given on the command line wins, otherwise it is taken from the extension of the archive read
+bool ResolveInputVersion(const std::string& path, DBVersion& version)
+{
+	if(version != DBVersion::DB_VERSION_AUTO)
+	{
+		return true;
+	}
+
+	auto extension = xr_file_system::split_path(path).extension;
+	if(!is_known(extension))
+	{
+		spdlog::error("Unknown input file extension");
+		return false;
+	}
+
+	version = ExtensionToDBVersion(extension);
+	return true;
+}
+
 int main(int argc, char *argv[])
 {
 	// TODO: reduce the scope of try-catch block
@@ -47,8 +90,14 @@ int main(int argc, char *argv[])
 		common_options.add_options()
 		    ("help", "produce help message")
 		    ("debug", "enable debug output")
+		    ("verbose", "log every packed or extracted file instead of a progress line")
 		    ("ro", "perform all the steps but do not write anything on disk")
 		    ("out", value<std::string>()->value_name("<PATH>"), "output file or folder name")
+		    ("jobs", value<std::size_t>()->value_name("<N>"), "number of worker threads (0 = all cores)")
+		    ("buffer", value<std::size_t>()->value_name("<KB>"), "size of the write buffer in KiB (0 = unbuffered)")
+		    ("metrics", "log time, calls and bytes of every stage at the end")
+		    ("metrics_json", value<std::string>()->value_name("<FILE>"), "save stage metrics as JSON, implies --metrics")
+		    ("cache", value<std::string>()->implicit_value("")->value_name("<DIR>"), "cache parsed archive headers (default: ~/.cache/db_converter)")
 		    ("11xx", "assume 1114/1154 archive format (unpack only)")
 		    ("2215", "assume 2215 archive format (unpack only)")
 		    ("2945", "assume 2945/2939 archive format (unpack only)")
@@ -59,12 +108,21 @@ int main(int argc, char *argv[])
 		options_description unpack_options("Unpack options");
 		unpack_options.add_options()
 		    ("unpack", value<std::string>()->value_name("<FILE>"), "unpack game archive")
-		    ("flt", value<std::string>()->value_name("<MASK>"), "extract files filtered by mask");
+		    ("verify", value<std::string>()->value_name("<FILE>"), "check crc of every file in game archive without extracting")
+		    ("list", value<std::string>()->value_name("<FILE>"), "print files of game archive without extracting")
+		    ("format", value<std::string>()->value_name("<FMT>")->default_value("text"), "format of --list: text, tsv or json")
+		    ("flt", value<std::vector<std::string>>()->composing()->value_name("<MASK>"), "extract only files matching the mask, same as --include")
+		    ("include", value<std::vector<std::string>>()->composing()->value_name("<PATTERN>"), "extract only files matching any of the patterns: glob (*.ltx, config/**), re:<regex> or substring")
+		    ("exclude", value<std::vector<std::string>>()->composing()->value_name("<PATTERN>"), "skip files matching any of the patterns")
+		    ("io_uring", "write extracted files through io_uring when available");
 
 		options_description pack_options("Pack options");
 		pack_options.add_options()
 		    ("pack", value<std::string>()->value_name("<DIR>"), "pack directory content into game archive")
-		    ("xdb_ud", value<std::string>()->value_name("<FILE>"), "attach user data file");
+		    ("xdb_ud", value<std::string>()->value_name("<FILE>"), "attach user data file")
+		    ("compress", "compress files with LZO1X")
+		    ("max", "use the best (slow) compression level, implies --compress")
+		    ("zero_copy", "copy files into the archive with copy_file_range instead of mapping them");
 
 		options_description all_options;
 		all_options.add(common_options).add(unpack_options).add(pack_options);
@@ -78,6 +136,11 @@ int main(int argc, char *argv[])
 			DBTools::set_debug(true);
 		}
 
+		if(vm.count("verbose"))
+		{
+			DBTools::set_verbose(true);
+		}
+
 		if(vm.count("help"))
 		{
 			spdlog::info("Usage examples:");
@@ -90,7 +153,7 @@ int main(int argc, char *argv[])
 			return 1;
 		}
 
-		if(IsConflictingOptionsExist(vm, {"pack", "unpack"}))
+		if(IsConflictingOptionsExist(vm, {"pack", "unpack", "verify", "list"}))
 		{
 			return 1;
 		}
@@ -112,6 +175,20 @@ int main(int argc, char *argv[])
 			tools_type = ToolsType::PACK;
 		}
 
+		if(vm.count("verify"))
+		{
+			tools_type = ToolsType::VERIFY;
+		}
+
+		if(vm.count("list"))
+		{
+			tools_type = ToolsType::LIST;
+
+			// the listing owns stdout, messages must not end up in the middle of it
+			spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+			spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+		}
+
 		bool is_read_only = false;
 		if(vm.count("ro"))
 		{
@@ -119,6 +196,27 @@ int main(int argc, char *argv[])
 			spdlog::info("Working in read-only mode");
 		}
 
+		if(vm.count("buffer"))
+		{
+			DBTools::set_write_buffer_size(vm["buffer"].as<std::size_t>() * 1024);
+		}
+
+		if(vm.count("metrics") || vm.count("metrics_json"))
+		{
+			DBTools::set_metrics(true, vm.count("metrics_json") ? vm["metrics_json"].as<std::string>() : "");
+		}
+
+		if(vm.count("cache"))
+		{
+			DBTools::set_index_cache(vm["cache"].as<std::string>());
+		}
+
+		std::size_t jobs = 1;
+		if(vm.count("jobs"))
+		{
+			jobs = vm["jobs"].as<std::size_t>();
+		}
+
 		auto version = DBVersion::DB_VERSION_AUTO;
 
 		std::vector<std::pair<std::string, DBVersion>> db_versions =
@@ -126,7 +224,7 @@ int main(int argc, char *argv[])
 			{"xdb",    DBVersion::DB_VERSION_XDB},
 			{"2947ru", DBVersion::DB_VERSION_2947RU},
 			{"2947ww", DBVersion::DB_VERSION_2947WW},
-			{"11xx",   DBVersion::DB_VERSION_AUTO},
+			{"11xx",   DBVersion::DB_VERSION_1114},
 			{"2215",   DBVersion::DB_VERSION_2215},
 			{"2945",   DBVersion::DB_VERSION_2945}
 		};
@@ -140,53 +238,46 @@ int main(int argc, char *argv[])
 			}
 		}
 
-		auto extension_to_db_version = [](const std::string& extension)
+		if(tools_type == ToolsType::UNPACK)
 		{
-			if(is_xdb(extension) || is_db(extension))
-			{
-				spdlog::info("Auto-detected version: xdb");
-				return DBVersion::DB_VERSION_XDB;
-			}
-			else if(is_xrp(extension))
+			auto source_path = vm["unpack"].as<std::string>();
+			if(!ResolveInputVersion(source_path, version))
 			{
-				spdlog::info("Auto-detected version: 1114");
-				return DBVersion::DB_VERSION_1114;
+				return 1;
 			}
-			else if(is_xp(extension))
+
+			auto destination_path = vm.count("out") ? vm["out"].as<std::string>() : xr_file_system::current_path();
+
+			if(vm.count("io_uring"))
 			{
-				spdlog::info("Auto-detected version: 2215");
-				return DBVersion::DB_VERSION_2215;
+				DBTools::set_io_uring(true);
 			}
 
-			return DBVersion::DB_VERSION_AUTO;
-		};
-
-		if(tools_type == ToolsType::UNPACK)
-		{
-			auto source_path = vm["unpack"].as<std::string>();
-			auto path_splitted = xr_file_system::split_path(source_path);
-			auto extension = path_splitted.extension;
+			PathFilter filter;
+			std::vector<std::pair<std::string, bool>> filter_options =
+			{
+				{"flt",     false},
+				{"include", false},
+				{"exclude", true}
+			};
 
-			if(version == DBVersion::DB_VERSION_AUTO)
+			for(const auto& [option, is_exclude] : filter_options)
 			{
-				if(!is_known(extension))
+				if(!vm.count(option))
 				{
-					spdlog::error("Unknown input file extension");
-					return 1;
+					continue;
 				}
 
-				version = extension_to_db_version(extension);
-			}
-
-			auto destination_path = vm.count("out") ? vm["out"].as<std::string>() : xr_file_system::current_path();
-
-			std::string filter;
-			if(vm.count("flt"))
-			{
-				filter = vm["flt"].as<std::string>();
+				for(const auto& pattern : vm[option].as<std::vector<std::string>>())
+				{
+					if(!(is_exclude ? filter.exclude(pattern) : filter.include(pattern)))
+					{
+						return 1;
+					}
+				}
 			}
 
-			DBTools::unpack(source_path, destination_path, version, filter, is_read_only);
+			DBTools::unpack(source_path, destination_path, version, filter, is_read_only, jobs);
 		}
 		else if(tools_type == ToolsType::PACK)
 		{
@@ -203,7 +294,7 @@ int main(int argc, char *argv[])
 					return 1;
 				}
 
-				version = extension_to_db_version(extension);
+				version = ExtensionToDBVersion(extension);
 			}
 
 			std::string xdb_ud;
@@ -212,7 +303,53 @@ int main(int argc, char *argv[])
 				xdb_ud = vm["xdb_ud"].as<std::string>();
 			}
 
-			DBTools::pack(source_path, destination_path, version, xdb_ud, is_read_only);
+			auto compression = CompressionLevel::NONE;
+			if(vm.count("max"))
+			{
+				compression = CompressionLevel::MAX;
+			}
+			else if(vm.count("compress"))
+			{
+				compression = CompressionLevel::FAST;
+			}
+
+			if(!DBTools::pack(source_path, destination_path, version, xdb_ud, is_read_only, jobs, compression, vm.count("zero_copy") != 0))
+			{
+				return 1;
+			}
+		}
+		else if(tools_type == ToolsType::VERIFY)
+		{
+			auto source_path = vm["verify"].as<std::string>();
+			if(!ResolveInputVersion(source_path, version))
+			{
+				return 1;
+			}
+
+			if(!DBTools::verify(source_path, version, jobs))
+			{
+				return 1;
+			}
+		}
+		else if(tools_type == ToolsType::LIST)
+		{
+			auto source_path = vm["list"].as<std::string>();
+			if(!ResolveInputVersion(source_path, version))
+			{
+				return 1;
+			}
+
+			ListFormat format;
+			if(!Lister::parse_format(vm["format"].as<std::string>(), format))
+			{
+				spdlog::error("Unknown listing format \"{}\"", vm["format"].as<std::string>());
+				return 1;
+			}
+
+			if(!DBTools::list(source_path, version, format))
+			{
+				return 1;
+			}
 		}
 		else
 		{
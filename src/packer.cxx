@@ -1,7 +1,10 @@
 #include "packer.hxx"
 #include "db_tools.hxx"
+#include "lzo_codec.hxx"
+#include "thread_pool.hxx"
 
 #include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_metrics.hxx"
 #include "xray_re/xr_utils.hxx"
 #include "xray_re/xr_lzhuf.hxx"
 #include "xray_re/xr_scrambler.hxx"
@@ -9,35 +12,39 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
+#include <mutex>
+#include <optional>
+#include <unistd.h>
 
 using namespace xray_re;
 
 extern bool m_debug;
 
-Packer::~Packer()
-{
-	delete_elements(m_files);
-}
+constexpr std::size_t STREAM_BUFFER_SIZE = 256*1024;
 
-void Packer::process(const std::string& source_path, const std::string& destination_path, const DBVersion& version, const std::string& xdb_ud, bool is_read_only)
+bool Packer::process(const std::string& source_path, const std::string& destination_path, const DBVersion& version, const std::string& xdb_ud, bool is_read_only, std::size_t jobs, CompressionLevel compression, bool zero_copy)
 {
 	if(source_path.empty())
 	{
 		spdlog::error("Missing source directory path");
-		return;
+		return false;
 	}
 
 	if(!xr_file_system::folder_exist(source_path))
 	{
 		spdlog::error("Failed to find folder {}", source_path);
-		return;
+		return false;
 	}
 
 	if(destination_path.empty())
 	{
 		spdlog::error("Missing destination file path");
-		return;
+		return false;
 	}
 
 	xr_file_system& fs = xr_file_system::instance();
@@ -54,22 +61,42 @@ void Packer::process(const std::string& source_path, const std::string& destinat
 	if(version == DBVersion::DB_VERSION_AUTO)
 	{
 		spdlog::error("Unspecified DB format");
-		return;
+		return false;
 	}
 
 	if(version == DBVersion::DB_VERSION_1114 || version == DBVersion::DB_VERSION_2215 || version == DBVersion::DB_VERSION_2945)
 	{
 		spdlog::error("Unsupported DB format");
-		return;
+		return false;
+	}
+
+	if(compression == CompressionLevel::MAX && !LZOCodec::is_max_level_supported())
+	{
+		spdlog::warn("LZO1X-999 is not available in this build, falling back to LZO1X-1");
+		compression = CompressionLevel::FAST;
+	}
+
+	if(compression != CompressionLevel::NONE && !LZOCodec::init())
+	{
+		return false;
 	}
 
 	fs.append_path_separator(m_root);
+	m_jobs = jobs;
+	m_compression = compression;
+	m_zero_copy = zero_copy;
+
+	if(m_zero_copy && m_compression != CompressionLevel::NONE)
+	{
+		spdlog::warn("Compressed files can't be copied by the kernel, zero-copy mode is disabled");
+		m_zero_copy = false;
+	}
 
 	m_archive = fs.w_open(destination_path);
 	if(!m_archive)
 	{
 		spdlog::error("Failed to load {}", destination_path);
-		return;
+		return false;
 	}
 
 	if(version == DBVersion::DB_VERSION_XDB && !xdb_ud.empty())
@@ -87,10 +114,25 @@ void Packer::process(const std::string& source_path, const std::string& destinat
 		}
 	}
 
+	// the tree is walked folder by folder, so the total isn't known in advance
+	m_progress = std::make_unique<Progress>("Packed", 0);
+
 	m_archive->open_chunk(DB_CHUNK_DATA);
 	m_root = source_path;
 	fs.append_path_separator(m_root);
-	process_folder(m_root);
+	if(!process_folder(m_root))
+	{
+		// the header would describe data that isn't there, such an archive is worse than none
+		fs.w_close(m_archive);
+		if(!is_read_only)
+		{
+			std::error_code error;
+			std::filesystem::remove(destination_path, error);
+		}
+
+		spdlog::error("Failed to pack {}", source_path);
+		return false;
+	}
 	m_archive->close_chunk();
 
 	auto w = new xr_memory_writer;
@@ -107,17 +149,24 @@ void Packer::process(const std::string& source_path, const std::string& destinat
 //		w->w_u32(0);
 //	}
 
-	spdlog::info("files: ");
-	for(const auto& file : m_files)
+	m_progress->finish();
+
+	if(Progress::is_verbose())
+	{
+		Progress::file("files: ");
+	}
+
+	m_entries.replace_in_paths('/', '\\');
+	for(std::size_t i = 0; i < m_entries.size(); i++)
 	{
-		std::replace(file->path.begin(), file->path.end(), '/', '\\');
-		w->w_size_u16(file->path.size() + 16);
-		w->w_size_u32(file->size_real);
-		w->w_size_u32(file->size_compressed);
-		w->w_u32(file->crc);
-		w->w_raw(file->path.data(), file->path.size());
-		spdlog::info("  {}", file->path);
-		w->w_size_u32(file->offset);
+		auto path = m_entries.path(i);
+		w->w_size_u16(path.size() + 16);
+		w->w_u32(m_entries.size_real(i));
+		w->w_u32(m_entries.size_compressed(i));
+		w->w_u32(m_entries.crc(i));
+		w->w_raw(path.data(), path.size());
+		Progress::file("  {}", path);
+		w->w_u32(m_entries.offset(i));
 	}
 
 	uint8_t *data = nullptr;
@@ -142,9 +191,11 @@ void Packer::process(const std::string& source_path, const std::string& destinat
 
 	delete data;
 	fs.w_close(m_archive);
+
+	return true;
 }
 
-void Packer::process_folder(const std::string& path)
+bool Packer::process_folder(const std::string& path)
 {
 	std::vector<std::filesystem::directory_entry> files, folders;
 
@@ -178,71 +229,265 @@ void Packer::process_folder(const std::string& path)
 
 	std::sort(files.begin(), files.end(), comparator);
 
+	std::vector<std::string> paths;
+	paths.reserve(files.size());
+
 	for(const auto& file : files)
 	{
 		auto entry_path = std::filesystem::path(file);
 		auto relative_path = std::filesystem::relative(entry_path, root_path);
-		process_file(relative_path);
+		paths.push_back(relative_path);
 	}
+
+	return process_files(paths);
 }
 
-void Packer::process_file(const std::string& path)
+bool Packer::process_files(const std::vector<std::string>& paths)
 {
-	constexpr bool compress_files = false;
+	std::size_t path_bytes = 0;
+	for(const auto& path : paths)
+	{
+		path_bytes += path.size();
+	}
+	m_entries.reserve(m_entries.size() + paths.size(), m_entries.paths().size() + path_bytes);
 
-	if constexpr(compress_files)
+	auto jobs = ThreadPool::resolve_jobs(m_jobs);
+
+	if(jobs == 1 || paths.size() < 2)
 	{
-		xr_file_system& fs = xr_file_system::instance();
-		auto reader = fs.r_open(m_root + path);
-		if(reader)
+		for(const auto& path : paths)
 		{
-			auto data = static_cast<const uint8_t*>(reader->data());
-			auto offset = m_archive->tell();
-			auto size = reader->size();
+			if(!process_file(path))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
 
-			uint8_t *data_compressed = nullptr;
-			uint32_t size_compressed = 0u;
-			xr_lzhuf::compress(data_compressed, size_compressed, data, size);
-			spdlog::info("{}->{} {}", size, size_compressed, path);
+	spdlog::info("Packing {} files using {} threads", paths.size(), jobs);
 
-			auto crc = crc32(data_compressed, size_compressed);
-			m_archive->w_raw(data_compressed, size_compressed);
-			fs.r_close(reader);
+	// Workers read and checksum files in any order, but only this thread appends
+	// them to the archive, strictly in the sorted order, so the layout is the same
+	// as with a single thread. The window bounds the number of files kept mapped.
+	const std::size_t window = jobs * 4;
+
+	std::vector<std::optional<PackedFile>> slots(paths.size());
+	std::mutex mutex;
+	std::condition_variable ready;
 
-			auto path_lowercase = path;
-			std::transform(path_lowercase.begin(), path_lowercase.end(), path_lowercase.begin(), [](unsigned char c) { return std::tolower(c); });
+	// one extra thread, the writer spends most of the time waiting for workers or disk
+	ThreadPool pool(jobs + 1);
 
-			auto file = new db_file;
-			file->path = path_lowercase;
-			file->crc = crc;
-			file->offset = offset;
-			file->size_real = size;
-			file->size_compressed = size_compressed;
-			m_files.push_back(file);
+	auto schedule = [&](std::size_t i)
+	{
+		pool.submit([&, i]()
+		{
+			auto file = prepare_file(paths[i]);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slots[i] = std::move(file);
+			}
+			ready.notify_all();
+		});
+	};
+
+	for(std::size_t i = 0; i < std::min(window, paths.size()); i++)
+	{
+		schedule(i);
+	}
+
+	bool result = true;
+	for(std::size_t i = 0; i < paths.size() && result; i++)
+	{
+		std::optional<PackedFile> file;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ready.wait(lock, [&slots, i] { return slots[i].has_value(); });
+			file.swap(slots[i]);
+		}
+
+		if(i + window < paths.size())
+		{
+			schedule(i + window);
+		}
+
+		result = write_file(*file);
+	}
+
+	// after a failure files prepared ahead are left in their slots
+	pool.wait();
+	for(auto& slot : slots)
+	{
+		if(slot)
+		{
+			release_file(*slot);
 		}
 	}
+
+	return result;
+}
+
+bool Packer::process_file(const std::string& path)
+{
+	auto file = prepare_file(path);
+	return write_file(file);
+}
+
+Packer::PackedFile Packer::prepare_file(const std::string& path) const
+{
+	if(m_zero_copy)
+	{
+		return prepare_file_stream(path);
+	}
+
+	PackedFile file;
+
+	xr_file_system& fs = xr_file_system::instance();
+	{
+		xr_metrics::scoped_timer timer(xr_metrics::FILE_OPEN);
+		file.reader = fs.r_open(m_root + path);
+	}
+
+	if(!file.reader)
+	{
+		return file;
+	}
+
+	file.path = path;
+	std::transform(file.path.begin(), file.path.end(), file.path.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	auto data = static_cast<const uint8_t*>(file.reader->data());
+	auto size = file.reader->size();
+
+	{
+		// the file is mapped, so this includes reading it from disk
+		xr_metrics::scoped_timer timer(xr_metrics::CRC, size);
+		file.crc = crc32(data, size);
+	}
+
+	file.size_real = size;
+	file.size_compressed = size;
+
+	if(LZOCodec::compress(file.data_compressed, data, size, m_compression))
+	{
+		file.size_compressed = file.data_compressed.size();
+		spdlog::debug("{}->{} {}", size, file.size_compressed, path);
+	}
 	else
 	{
-		xr_file_system& fs = xr_file_system::instance();
-		auto reader = fs.r_open(m_root + path);
-		if(reader)
+		// store as is
+		std::vector<uint8_t>().swap(file.data_compressed);
+	}
+
+	return file;
+}
+
+Packer::PackedFile Packer::prepare_file_stream(const std::string& path) const
+{
+	PackedFile file;
+
+	auto full_path = m_root + path;
+	file.fd = ::open(full_path.c_str(), O_RDONLY);
+	if(file.fd == -1)
+	{
+		spdlog::error("Failed to open file \"{}\": {} (errno={}) ", full_path, strerror(errno), errno);
+		return file;
+	}
+
+	file.path = path;
+	std::transform(file.path.begin(), file.path.end(), file.path.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	// checksum is computed on the fly, the data itself is copied later by the kernel straight into the archive
+	thread_local std::vector<uint8_t> buffer(STREAM_BUFFER_SIZE);
+
+	uint32_t crc = 0;
+	std::size_t size = 0;
+	while(true)
+	{
+		ssize_t res;
 		{
-			auto offset = m_archive->tell();
-			auto size = reader->size();
-			auto crc = crc32(reader->data(), size);
-			m_archive->w_raw(reader->data(), size);
-			fs.r_close(reader);
+			xr_metrics::scoped_timer timer(xr_metrics::FILE_READ);
+			res = ::read(file.fd, buffer.data(), buffer.size());
+			timer.set_bytes(res > 0 ? static_cast<uint64_t>(res) : 0);
+		}
+
+		if(res == 0)
+		{
+			break;
+		}
+
+		if(res == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			spdlog::error("Failed to read file \"{}\": {} (errno={}) ", full_path, strerror(errno), errno);
+			::close(file.fd);
+			file.fd = -1;
+			return file;
+		}
 
-			std::string path_lowercase = path;
-			std::transform(path_lowercase.begin(), path_lowercase.end(), path_lowercase.begin(), [](unsigned char c) { return std::tolower(c); });
+		xr_metrics::scoped_timer crc_timer(xr_metrics::CRC, static_cast<uint64_t>(res));
+		crc = crc32(crc, buffer.data(), static_cast<std::size_t>(res));
+		size += static_cast<std::size_t>(res);
+	}
+
+	file.crc = crc;
+	file.size_real = size;
+	file.size_compressed = size;
+
+	return file;
+}
 
-			auto file = new db_file;
-			file->path = path_lowercase;
-			file->crc = crc;
-			file->offset = offset;
-			file->size_real = size;
-			file->size_compressed = size;
-			m_files.push_back(file);
+bool Packer::write_file(PackedFile& file)
+{
+	if(!file.reader && file.fd == -1)
+	{
+		return true;
+	}
+
+	auto offset = m_archive->tell();
+
+	if(!file.data_compressed.empty())
+	{
+		m_archive->w_raw(file.data_compressed.data(), file.size_compressed);
+		std::vector<uint8_t>().swap(file.data_compressed);
+	}
+	else if(file.fd != -1)
+	{
+		// the size and crc are already known, a file that shrank since can't be stored consistently
+		if(!m_archive->w_file(file.fd, file.size_real))
+		{
+			spdlog::error("Failed to read file \"{}\", it changed while being packed: {} (errno={}) ", file.path, strerror(errno), errno);
+			release_file(file);
+			return false;
 		}
 	}
+	else
+	{
+		m_archive->w_raw(file.reader->data(), file.size_compressed);
+	}
+
+	release_file(file);
+
+	m_entries.add(file.path, static_cast<uint32_t>(offset), static_cast<uint32_t>(file.size_real), static_cast<uint32_t>(file.size_compressed), file.crc);
+	m_progress->advance(file.size_real);
+	return true;
+}
+
+void Packer::release_file(PackedFile& file)
+{
+	if(file.reader)
+	{
+		xr_file_system::r_close(file.reader);
+	}
+
+	if(file.fd != -1)
+	{
+		::close(file.fd);
+		file.fd = -1;
+	}
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "entry_table.hxx"
+#include "progress.hxx"
 #include "xray_re/xr_types.hxx"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,17 +17,39 @@ namespace xray_re
 class Packer
 {
 public:
-	~Packer();
+	~Packer() = default;
 
-	void process(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only);
+	// false if the archive couldn't be made, a partially written one is removed
+	bool process(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& xdb_ud, bool is_read_only, std::size_t jobs = 1, xray_re::CompressionLevel compression = xray_re::CompressionLevel::NONE, bool zero_copy = false);
 
 private:
-	void process_folder(const std::string& path = "");
-	void process_file(const std::string& path);
+	// source file ready to be appended to the archive
+	struct PackedFile
+	{
+		std::string path;
+		xray_re::xr_reader *reader{nullptr};
+		int fd{-1}; // zero-copy mode, data is moved from the descriptor by the kernel
+		std::vector<uint8_t> data_compressed;
+		uint32_t crc{0};
+		std::size_t size_real{0};
+		std::size_t size_compressed{0};
+	};
+
+	bool process_folder(const std::string& path = "");
+	bool process_files(const std::vector<std::string>& paths);
+	bool process_file(const std::string& path);
+	PackedFile prepare_file(const std::string& path) const;
+	PackedFile prepare_file_stream(const std::string& path) const;
+	bool write_file(PackedFile& file);
+	static void release_file(PackedFile& file);
 	void add_folder(const std::string& path);
 
 	xray_re::xr_writer *m_archive;
 	std::string m_root;
+	std::size_t m_jobs{1};
+	xray_re::CompressionLevel m_compression{xray_re::CompressionLevel::NONE};
+	bool m_zero_copy{false};
 	std::vector<std::string> m_folders;
-	std::vector<xray_re::db_file*> m_files;
+	EntryTable m_entries;
+	std::unique_ptr<Progress> m_progress;
 };
@@ -0,0 +1,252 @@
+#include "path_filter.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+// folds case and separators, so a single comparison covers both
+static inline char Fold(char c)
+{
+	if(c == '\\')
+	{
+		return '/';
+	}
+
+	return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static std::string_view FileName(std::string_view path)
+{
+	auto separator = path.find_last_of("/\\");
+	return separator == std::string_view::npos ? path : path.substr(separator + 1);
+}
+
+bool PathFilter::include(std::string_view pattern)
+{
+	Rule rule;
+	if(!compile(pattern, rule))
+	{
+		return false;
+	}
+
+	m_includes.push_back(std::move(rule));
+	return true;
+}
+
+bool PathFilter::exclude(std::string_view pattern)
+{
+	Rule rule;
+	if(!compile(pattern, rule))
+	{
+		return false;
+	}
+
+	m_excludes.push_back(std::move(rule));
+	return true;
+}
+
+bool PathFilter::empty() const
+{
+	return m_includes.empty() && m_excludes.empty();
+}
+
+bool PathFilter::matches(std::string_view path) const
+{
+	if(!m_includes.empty() && std::none_of(m_includes.begin(), m_includes.end(), [path](const Rule& rule) { return match(rule, path); }))
+	{
+		return false;
+	}
+
+	return std::none_of(m_excludes.begin(), m_excludes.end(), [path](const Rule& rule) { return match(rule, path); });
+}
+
+bool PathFilter::compile(std::string_view pattern, Rule& rule)
+{
+	if(pattern.empty())
+	{
+		spdlog::error("Empty filter pattern");
+		return false;
+	}
+
+	constexpr std::string_view regex_prefix = "re:";
+	if(pattern.substr(0, regex_prefix.size()) == regex_prefix)
+	{
+		rule.kind = Kind::REGEX;
+		rule.pattern = pattern.substr(regex_prefix.size());
+
+		try
+		{
+			rule.regex = std::regex(rule.pattern, std::regex::ECMAScript | std::regex::icase | std::regex::optimize | std::regex::nosubs);
+		}
+		catch(const std::regex_error& e)
+		{
+			spdlog::error("Invalid regex \"{}\": {}", rule.pattern, e.what());
+			return false;
+		}
+
+		return true;
+	}
+
+	rule.pattern.resize(pattern.size());
+	std::transform(pattern.begin(), pattern.end(), rule.pattern.begin(), Fold);
+
+	if(rule.pattern.find_first_of("*?[") != std::string::npos)
+	{
+		rule.kind = Kind::GLOB;
+		rule.name_only = rule.pattern.find('/') == std::string::npos;
+	}
+
+	return true;
+}
+
+bool PathFilter::match(const Rule& rule, std::string_view path)
+{
+	switch(rule.kind)
+	{
+		case Kind::SUBSTRING:
+		{
+			return contains(path, rule.pattern);
+		}
+		case Kind::GLOB:
+		{
+			return match_glob(rule.pattern, rule.name_only ? FileName(path) : path);
+		}
+		case Kind::REGEX:
+		{
+			// the copy is reused by the thread, so only the first paths allocate
+			thread_local std::string folded;
+			folded.assign(path);
+			std::replace(folded.begin(), folded.end(), '\\', '/');
+			return std::regex_search(folded.data(), folded.data() + folded.size(), rule.regex);
+		}
+	}
+
+	return false;
+}
+
+bool PathFilter::match_glob(std::string_view pattern, std::string_view path)
+{
+	std::size_t p = 0;
+	std::size_t s = 0;
+
+	while(p < pattern.size())
+	{
+		auto c = pattern[p];
+		if(c == '*')
+		{
+			bool any_folder = p + 1 < pattern.size() && pattern[p + 1] == '*';
+			auto rest = pattern.substr(p + (any_folder ? 2 : 1));
+
+			// "**/" as a whole folder level also stands for no folder at all: "config/**/x.ltx" matches "config/x.ltx"
+			bool whole_level = any_folder && !rest.empty() && rest.front() == '/' && (p == 0 || pattern[p - 1] == '/');
+			if(whole_level && match_glob(rest.substr(1), path.substr(s)))
+			{
+				return true;
+			}
+
+			// a literal tail like in "*.ltx" only has to be compared with the end of the path
+			if(rest.find_first_of("*?[") == std::string_view::npos)
+			{
+				if(path.size() - s < rest.size())
+				{
+					return false;
+				}
+
+				auto skipped = path.substr(s, path.size() - s - rest.size());
+				if(!any_folder && skipped.find_first_of("/\\") != std::string_view::npos)
+				{
+					return false;
+				}
+
+				return std::equal(rest.begin(), rest.end(), path.end() - rest.size(), [](char a, char b) { return a == Fold(b); });
+			}
+
+			// try every split, '*' may not swallow a separator
+			for(auto i = s; i <= path.size(); i++)
+			{
+				if(match_glob(rest, path.substr(i)))
+				{
+					return true;
+				}
+
+				if(i < path.size() && !any_folder && Fold(path[i]) == '/')
+				{
+					break;
+				}
+			}
+
+			return false;
+		}
+
+		if(s >= path.size())
+		{
+			return false;
+		}
+
+		auto value = Fold(path[s]);
+		if(c == '?')
+		{
+			if(value == '/')
+			{
+				return false;
+			}
+		}
+		else if(c == '[')
+		{
+			auto end = pattern.find(']', p + 2);
+			if(end == std::string_view::npos)
+			{
+				// unterminated class is an ordinary character
+				if(value != '[')
+				{
+					return false;
+				}
+			}
+			else
+			{
+				auto set = pattern.substr(p + 1, end - p - 1);
+				bool negate = set.front() == '!' || set.front() == '^';
+				if(negate)
+				{
+					set.remove_prefix(1);
+				}
+
+				bool found = false;
+				for(std::size_t i = 0; i < set.size() && !found; i++)
+				{
+					if(i + 2 < set.size() && set[i + 1] == '-')
+					{
+						found = value >= set[i] && value <= set[i + 2];
+						i += 2;
+					}
+					else
+					{
+						found = value == set[i];
+					}
+				}
+
+				if(found == negate)
+				{
+					return false;
+				}
+
+				p = end;
+			}
+		}
+		else if(c != value)
+		{
+			return false;
+		}
+
+		p++;
+		s++;
+	}
+
+	return s == path.size();
+}
+
+bool PathFilter::contains(std::string_view path, std::string_view needle)
+{
+	auto it = std::search(path.begin(), path.end(), needle.begin(), needle.end(), [](char a, char b) { return Fold(a) == b; });
+	return it != path.end() || needle.empty();
+}
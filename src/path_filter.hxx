@@ -0,0 +1,50 @@
+#pragma once
+
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Include and exclude rules for archive paths, compiled once and matched against paths exactly
+// as they are stored in the header: either separator, any case. A path passes when it matches
+// any include rule (or there are none) and no exclude rule.
+//
+// Pattern syntax:
+//   re:<regex>  ECMAScript regex searched in the path, '\' separators are seen as '/'
+//   *.ltx       glob if there is any of * ? [ in it: '*' stays within a folder, '**' crosses them
+//               and '**/' also matches no folder at all,
+//               a pattern without '/' is matched against the file name only
+//   config/     anything else is a substring, like the old --flt mask
+class PathFilter
+{
+public:
+	bool include(std::string_view pattern);
+	bool exclude(std::string_view pattern);
+
+	bool empty() const;
+	bool matches(std::string_view path) const;
+
+private:
+	enum class Kind
+	{
+		SUBSTRING,
+		GLOB,
+		REGEX
+	};
+
+	struct Rule
+	{
+		Kind kind{Kind::SUBSTRING};
+		bool name_only{false};
+		std::string pattern;
+		std::regex regex;
+	};
+
+	static bool compile(std::string_view pattern, Rule& rule);
+	static bool match(const Rule& rule, std::string_view path);
+	static bool match_glob(std::string_view pattern, std::string_view path);
+	static bool contains(std::string_view path, std::string_view needle);
+
+	std::vector<Rule> m_includes;
+	std::vector<Rule> m_excludes;
+};
@@ -0,0 +1,110 @@
+#include "progress.hxx"
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+std::chrono::milliseconds Progress::s_interval{1000};
+std::shared_ptr<spdlog::logger> Progress::s_files;
+
+Progress::Progress(const std::string& action, std::size_t total_files, uint64_t total_bytes) :
+	m_action(action), m_total_files(total_files), m_total_bytes(total_bytes), m_start(clock::now()),
+	m_next_report((m_start + s_interval).time_since_epoch().count()) {}
+
+void Progress::advance(uint64_t bytes)
+{
+	m_files_done++;
+	m_bytes_done += bytes;
+
+	auto now = clock::now();
+	auto next = m_next_report.load(std::memory_order_relaxed);
+	if(now.time_since_epoch().count() < next)
+	{
+		return;
+	}
+
+	// only the thread that moves the deadline prints the line
+	if(m_next_report.compare_exchange_strong(next, (now + s_interval).time_since_epoch().count()))
+	{
+		report(now);
+	}
+}
+
+void Progress::finish()
+{
+	auto seconds = std::chrono::duration<double>(clock::now() - m_start).count();
+	auto megabytes = m_bytes_done / (1024.0 * 1024.0);
+
+	spdlog::info("{} {} files, {:.1f} MiB in {:.2f}s ({:.1f} MiB/s)", m_action, m_files_done.load(), megabytes, seconds,
+		seconds > 0 ? megabytes / seconds : 0.0);
+
+	if(s_files)
+	{
+		s_files->flush();
+	}
+}
+
+std::size_t Progress::files_done() const
+{
+	return m_files_done;
+}
+
+uint64_t Progress::bytes_done() const
+{
+	return m_bytes_done;
+}
+
+void Progress::set_verbose(bool value)
+{
+	if(value && !s_files)
+	{
+		spdlog::init_thread_pool(8192, 1);
+		s_files = spdlog::create_async<spdlog::sinks::stdout_color_sink_mt>("files");
+		// same look as the default logger, the name would only clutter every line
+		s_files->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+	}
+	else if(!value && s_files)
+	{
+		spdlog::drop("files");
+		s_files.reset();
+	}
+}
+
+bool Progress::is_verbose()
+{
+	return s_files != nullptr;
+}
+
+void Progress::set_interval(std::chrono::milliseconds interval)
+{
+	s_interval = interval;
+}
+
+void Progress::report(clock::time_point now) const
+{
+	auto seconds = std::chrono::duration<double>(now - m_start).count();
+	auto files = m_files_done.load();
+	auto bytes = m_bytes_done.load();
+
+	auto files_rate = files / seconds;
+	auto bytes_rate = bytes / seconds;
+
+	if(m_total_files == 0)
+	{
+		spdlog::info("{} {} files, {:.0f} files/s, {:.1f} MiB/s", m_action, files, files_rate, bytes_rate / (1024.0 * 1024.0));
+		return;
+	}
+
+	// remaining bytes tell more than remaining files when sizes are known
+	double eta = 0;
+	if(m_total_bytes != 0 && bytes_rate > 0)
+	{
+		eta = (m_total_bytes > bytes ? m_total_bytes - bytes : 0) / bytes_rate;
+	}
+	else if(files_rate > 0)
+	{
+		eta = (m_total_files > files ? m_total_files - files : 0) / files_rate;
+	}
+
+	spdlog::info("{} {}/{} files ({:.0f}%), {:.0f} files/s, {:.1f} MiB/s, ETA {:.0f}s", m_action, files, m_total_files,
+		100.0 * files / m_total_files, files_rate, bytes_rate / (1024.0 * 1024.0), eta);
+}
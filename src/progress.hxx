@@ -0,0 +1,65 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Aggregated progress of packing or extraction. Workers only bump counters, one line with
+// rates and ETA is printed at most once per interval by whichever thread notices it is due.
+// Per-file messages go to a separate asynchronous logger, which exists only in verbose mode.
+class Progress
+{
+public:
+	// totals may be 0 when they are not known up front: ETA is estimated from files
+	// without total_bytes and isn't shown at all without total_files
+	Progress(const std::string& action, std::size_t total_files, uint64_t total_bytes = 0);
+
+	Progress(const Progress&) = delete;
+	Progress& operator=(const Progress&) = delete;
+
+	// one more file of the given size is done, thread-safe
+	void advance(uint64_t bytes);
+	// prints the summary of the whole run
+	void finish();
+
+	std::size_t files_done() const;
+	uint64_t bytes_done() const;
+
+	static void set_verbose(bool value);
+	static bool is_verbose();
+	static void set_interval(std::chrono::milliseconds interval);
+
+	template<typename... Args>
+	static void file(spdlog::format_string_t<Args...> format, Args&&... args);
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	void report(clock::time_point now) const;
+
+	std::string m_action;
+	std::size_t m_total_files;
+	uint64_t m_total_bytes;
+	clock::time_point m_start;
+
+	std::atomic<std::size_t> m_files_done{0};
+	std::atomic<uint64_t> m_bytes_done{0};
+	std::atomic<clock::rep> m_next_report;
+
+	static std::chrono::milliseconds s_interval;
+	static std::shared_ptr<spdlog::logger> s_files;
+};
+
+template<typename... Args>
+void Progress::file(spdlog::format_string_t<Args...> format, Args&&... args)
+{
+	if(s_files)
+	{
+		s_files->info(format, std::forward<Args>(args)...);
+	}
+}
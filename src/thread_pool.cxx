@@ -0,0 +1,115 @@
+#include "thread_pool.hxx"
+
+#include <atomic>
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+	// the calling thread takes part in parallel_for, so one worker less is enough
+	for(std::size_t i = 1; i < threads; i++)
+	{
+		m_threads.emplace_back(&ThreadPool::worker, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_task_added.notify_all();
+
+	for(auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	if(m_threads.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push(std::move(task));
+	}
+
+	m_task_added.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_task_done.wait(lock, [this] { return m_tasks.empty() && m_active == 0; });
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& func)
+{
+	std::atomic<std::size_t> next{0};
+
+	auto loop = [&next, &func, count]()
+	{
+		for(auto i = next++; i < count; i = next++)
+		{
+			func(i);
+		}
+	};
+
+	for(std::size_t i = 0; i < m_threads.size(); i++)
+	{
+		submit(loop);
+	}
+
+	loop();
+	wait();
+}
+
+std::size_t ThreadPool::size() const
+{
+	return m_threads.size() + 1;
+}
+
+std::size_t ThreadPool::resolve_jobs(std::size_t jobs)
+{
+	if(jobs == 0)
+	{
+		jobs = std::thread::hardware_concurrency();
+	}
+
+	return jobs == 0 ? 1 : jobs;
+}
+
+void ThreadPool::worker()
+{
+	while(true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_task_added.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+
+			if(m_stop && m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+			m_active++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_active--;
+		}
+
+		m_task_done.notify_all();
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(std::size_t threads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task);
+	void wait();
+
+	// Calls func(i) for every i in [0, count) using all workers of the pool.
+	// With a single worker everything runs in the calling thread.
+	void parallel_for(std::size_t count, const std::function<void(std::size_t)>& func);
+
+	std::size_t size() const;
+
+	// 0 means "use all available cores"
+	static std::size_t resolve_jobs(std::size_t jobs);
+
+private:
+	void worker();
+
+	std::vector<std::thread> m_threads;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_task_added;
+	std::condition_variable m_task_done;
+	std::size_t m_active{0};
+	bool m_stop{false};
+};
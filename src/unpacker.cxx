@@ -1,16 +1,33 @@
 #include "unpacker.hxx"
+#include "buffer_pool.hxx"
+#include "index_cache.hxx"
+#include "lzo_codec.hxx"
+#include "progress.hxx"
+#include "crc32/crc32.hxx"
+#include "thread_pool.hxx"
 #include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_metrics.hxx"
+#include "xray_re/xr_mmap_reader_posix.hxx"
+#include "xray_re/xr_uring_writer_posix.hxx"
 #include "xray_re/xr_scrambler.hxx"
 #include "xray_re/xr_lzhuf.hxx"
-#include "lzo/minilzo.h"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <memory>
+
 using namespace xray_re;
 
 extern bool m_debug;
 
-void Unpacker::process(const std::string& source_path, const std::string& destination_path, const DBVersion& version, const std::string& filter, bool is_read_only)
+// nothing checks header records against the file, a damaged header can point anywhere
+static bool IsInArchive(uint32_t offset, uint32_t size, std::size_t archive_size)
+{
+	return offset <= archive_size && size <= archive_size - offset;
+}
+
+void Unpacker::process(const std::string& source_path, const std::string& destination_path, const DBVersion& version, const PathFilter& filter, bool is_read_only, std::size_t jobs)
 {
 	if(version == DBVersion::DB_VERSION_AUTO)
 	{
@@ -44,7 +61,11 @@ void Unpacker::process(const std::string& source_path, const std::string& destin
 		return;
 	}
 
-	if(fs.create_path(output_folder))
+	m_folders.clear();
+	m_folder_handles.clear();
+	BufferPool::reset_peak();
+
+	if(m_folders.create(fs, output_folder))
 	{
 		xr_file_system::append_path_separator(output_folder);
 
@@ -57,108 +78,421 @@ void Unpacker::process(const std::string& source_path, const std::string& destin
 			reader_full->close_chunk(reader_chunk);
 		}
 
+		auto data_full = static_cast<const uint8_t*>(reader_full->data());
+
+		m_jobs = jobs;
+		m_archive_data = data_full;
+		if(auto reader_mmap = dynamic_cast<xr_mmap_reader_posix*>(reader_full))
+		{
+			m_archive_fd = reader_mmap->fd();
+		}
+
 		switch(version)
 		{
 			case DBVersion::DB_VERSION_1114:
 			case DBVersion::DB_VERSION_2215:
-			case DBVersion::DB_VERSION_2945:
-			case DBVersion::DB_VERSION_XDB:
 			{
-				reader_chunk = reader_full->open_chunk(DB_CHUNK_HEADER);
+				reader_chunk = open_header(reader_full, version);
+				if(!reader_chunk)
+				{
+					break;
+				}
+
+				if(version == DBVersion::DB_VERSION_1114)
+				{
+					extract_1114(output_folder, filter, reader_chunk, data_full, reader_full->size());
+				}
+				else
+				{
+					extract_2215(output_folder, filter, reader_chunk, data_full, reader_full->size());
+				}
+
+				reader_full->close_chunk(reader_chunk);
 				break;
 			}
+			case DBVersion::DB_VERSION_2945:
 			case DBVersion::DB_VERSION_2947RU:
-			{
-				xr_scrambler scrambler(xr_scrambler::CC_RU);
-				reader_chunk = reader_full->open_chunk(DB_CHUNK_HEADER, scrambler);
-				break;
-			}
 			case DBVersion::DB_VERSION_2947WW:
+			case DBVersion::DB_VERSION_XDB:
 			{
-				xr_scrambler scrambler(xr_scrambler::CC_WW);
-				reader_chunk = reader_full->open_chunk(DB_CHUNK_HEADER, scrambler);
+				EntryTable entries;
+				if(!read_files(source_path, reader_full, version, entries))
+				{
+					break;
+				}
+
+				if(version == DBVersion::DB_VERSION_2945)
+				{
+					extract_2945(output_folder, filter, entries, data_full);
+				}
+				else
+				{
+					extract_2947(output_folder, filter, entries, data_full);
+				}
 				break;
 			}
 			default:
 			{
 				spdlog::error("Unknown DB format");
+				break;
+			}
+		}
+	}
+	else
+	{
+		spdlog::error("Failed to create {}", output_folder);
+	}
+	fs.r_close(reader_full);
+
+	if(BufferPool::peak() != 0)
+	{
+		spdlog::info("Decompression buffers peaked at {} KiB", (BufferPool::peak() + 1023) / 1024);
+	}
+}
+
+bool Unpacker::verify(const std::string& source_path, const DBVersion& version, std::size_t jobs, std::vector<std::string> *damaged)
+{
+	if(version != DBVersion::DB_VERSION_2945 && version != DBVersion::DB_VERSION_2947RU &&
+	   version != DBVersion::DB_VERSION_2947WW && version != DBVersion::DB_VERSION_XDB)
+	{
+		spdlog::error("Only 2945, 2947 and XDB archives have checksums");
+		return false;
+	}
+
+	if(!xr_file_system::file_exist(source_path))
+	{
+		spdlog::error("File \"{}\" doesn't exist", source_path);
+		return false;
+	}
+
+	xr_file_system& fs = xr_file_system::instance();
+	auto reader_full = fs.r_open(source_path);
+	if(!reader_full)
+	{
+		spdlog::error("Can't load {}", source_path);
+		return false;
+	}
+
+	EntryTable entries;
+	if(!read_files(source_path, reader_full, version, entries))
+	{
+		spdlog::error("Failed to read header of {}", source_path);
+		fs.r_close(reader_full);
+		return false;
+	}
+
+	std::vector<uint32_t> files;
+	for(std::size_t i = 0; i < entries.size(); i++)
+	{
+		if(!entries.is_folder(i))
+		{
+			files.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	auto data = static_cast<const uint8_t*>(reader_full->data());
+	auto archive_size = reader_full->size();
+
+	std::vector<std::string> errors(files.size());
+	jobs = ThreadPool::resolve_jobs(jobs);
+
+	ThreadPool pool(std::min(jobs, std::max<std::size_t>(files.size(), 1)));
+	pool.parallel_for(files.size(), [&](std::size_t i)
+	{
+		auto entry = files[i];
+		auto size_real = entries.size_real(entry);
+		if(std::size_t(entries.offset(entry)) + entries.size_compressed(entry) > archive_size)
+		{
+			errors[i] = "entry is out of archive bounds";
+			return;
+		}
+
+		auto src = data + entries.offset(entry);
+		auto& pool = BufferPool::local();
+		BufferPool::Buffer buffer;
+
+		if(entries.is_compressed(entry))
+		{
+			buffer = pool.acquire(size_real);
+			if(!buffer.data)
+			{
+				errors[i] = "out of memory";
 				return;
 			}
+
+			if(!LZOCodec::decompress(buffer.data, size_real, src, entries.size_compressed(entry)))
+			{
+				errors[i] = "decompression failed";
+				pool.release(buffer);
+				return;
+			}
+
+			src = buffer.data;
 		}
 
-		if(reader_chunk)
+		uint32_t crc;
 		{
-			auto data_full = static_cast<const uint8_t*>(reader_full->data());
-			switch (version)
+			xr_metrics::scoped_timer timer(xr_metrics::CRC, size_real);
+			crc = crc32(src, size_real);
+		}
+
+		pool.release(buffer);
+
+		if(crc != entries.crc(entry))
+		{
+			errors[i] = fmt::format("crc mismatch, expected {:#x}, got {:#x}", entries.crc(entry), crc);
+		}
+	});
+
+	fs.r_close(reader_full);
+
+	std::size_t failed = std::count_if(errors.begin(), errors.end(), [](const auto& error) { return !error.empty(); });
+	if(failed != 0)
+	{
+		spdlog::error("{} of {} files are damaged:", failed, files.size());
+		for(std::size_t i = 0; i < files.size(); i++)
+		{
+			if(!errors[i].empty())
 			{
-				case DBVersion::DB_VERSION_1114:
-				{
-					extract_1114(output_folder, filter, reader_chunk, data_full);
-					break;
-				}
-				case DBVersion::DB_VERSION_2215:
+				spdlog::error("  {}: {}", entries.path(files[i]), errors[i]);
+				if(damaged)
 				{
-					extract_2215(output_folder, filter, reader_chunk, data_full);
-					break;
-				}
-				case DBVersion::DB_VERSION_2945:
-				{
-					extract_2945(output_folder, filter, reader_chunk, data_full);
-					break;
-				}
-				case DBVersion::DB_VERSION_2947RU:
-				case DBVersion::DB_VERSION_2947WW:
-				case DBVersion::DB_VERSION_XDB:
-				{
-					extract_2947(output_folder, filter, reader_chunk, data_full);
-					break;
-				}
-				default:
-				{
-					spdlog::error("Unknown DB format");
-					return;
+					damaged->emplace_back(entries.path(files[i]));
 				}
 			}
-			reader_full->close_chunk(reader_chunk);
 		}
+
+		return false;
 	}
-	else
+
+	spdlog::info("{} files verified, no errors found", files.size());
+	return true;
+}
+
+xr_reader* Unpacker::open_header(xr_reader *reader, const DBVersion& version)
+{
+	switch(version)
 	{
-		spdlog::error("Failed to create {}", output_folder);
+		case DBVersion::DB_VERSION_1114:
+		case DBVersion::DB_VERSION_2215:
+		case DBVersion::DB_VERSION_2945:
+		case DBVersion::DB_VERSION_XDB:
+		{
+			return reader->open_chunk(DB_CHUNK_HEADER);
+		}
+		case DBVersion::DB_VERSION_2947RU:
+		{
+			xr_scrambler scrambler(xr_scrambler::CC_RU);
+			return reader->open_chunk(DB_CHUNK_HEADER, scrambler);
+		}
+		case DBVersion::DB_VERSION_2947WW:
+		{
+			xr_scrambler scrambler(xr_scrambler::CC_WW);
+			return reader->open_chunk(DB_CHUNK_HEADER, scrambler);
+		}
+		default:
+		{
+			spdlog::error("Unknown DB format");
+			return nullptr;
+		}
 	}
-	fs.r_close(reader_full);
 }
 
-void Unpacker::extract_1114(const std::string& prefix, const std::string& mask, xr_reader *reader, const uint8_t *data)
+bool Unpacker::read_files(const std::string& source_path, xr_reader *reader, const DBVersion& version, EntryTable& entries)
 {
-	xr_file_system& fs = xr_file_system::instance();
-	while(!reader->eof())
+	// the raw header chunk is cheap to checksum and tells whether a cached index still matches
+	uint32_t header_crc = 0;
+	if(IndexCache::is_enabled())
 	{
-		std::string name;
-		reader->r_sz(name);
+		auto size = reader->find_chunk(DB_CHUNK_HEADER);
+		header_crc = crc32(reader->pointer<uint8_t>(), size);
 
+		if(IndexCache::load(source_path, version, header_crc, entries))
+		{
+			return true;
+		}
+	}
+
+	auto reader_chunk = open_header(reader, version);
+	if(!reader_chunk)
+	{
+		return false;
+	}
+
+	entries.clear();
+	auto archive_size = reader->size();
+	bool is_read = false;
+	switch(version)
+	{
+		case DBVersion::DB_VERSION_1114:
+		{
+			is_read = read_files_1114(reader_chunk, static_cast<const uint8_t*>(reader->data()), archive_size, entries);
+			break;
+		}
+		case DBVersion::DB_VERSION_2215:
+		{
+			is_read = read_files_2215(reader_chunk, archive_size, entries);
+			break;
+		}
+		case DBVersion::DB_VERSION_2945:
+		{
+			is_read = read_files_2945(reader_chunk, archive_size, entries);
+			break;
+		}
+		default:
+		{
+			is_read = read_files_2947(reader_chunk, archive_size, entries);
+			break;
+		}
+	}
+	reader->close_chunk(reader_chunk);
+
+	if(!is_read)
+	{
+		entries.clear();
+		return false;
+	}
+	entries.replace_in_paths('\\', '/');
+
+	if(IndexCache::is_enabled())
+	{
+		IndexCache::store(source_path, version, header_crc, entries);
+	}
+
+	return true;
+}
+
+bool Unpacker::read_files_1114(xr_reader *reader, const uint8_t *data, std::size_t archive_size, EntryTable& entries)
+{
+	while(!reader->eof())
+	{
+		std::string_view path = reader->skip_sz();
 		auto uncompressed = reader->r_u32();
 		auto offset = reader->r_u32();
 		auto size = reader->r_u32();
 
-		std::replace(name.begin(), name.end(), '\\', '/');
-		auto path = prefix + name;
+		if(!IsInArchive(offset, size, archive_size))
+		{
+			spdlog::error("Entry {} is out of the archive bounds", path);
+			return false;
+		}
+
+		// the unpacked size of an LZHUF entry is only stored in front of its data
+		auto size_real = uncompressed || offset == 0 ? size : xr_lzhuf::decompressed_size(data + offset, size);
+		entries.add(path, offset, size_real, size, 0);
+	}
 
-		if(mask.length() > 0 && offset != 0 && path.find(mask) == std::string::npos)
+	return true;
+}
+
+bool Unpacker::read_files_2215(xr_reader *reader, std::size_t archive_size, EntryTable& entries)
+{
+	while(!reader->eof())
+	{
+		std::string_view path = reader->skip_sz();
+		auto offset = reader->r_u32();
+		auto size_real = reader->r_u32();
+		auto size_compressed = reader->r_u32();
+
+		if(!IsInArchive(offset, size_compressed, archive_size))
 		{
-			continue;
+			spdlog::error("Entry {} is out of the archive bounds", path);
+			return false;
 		}
 
-		spdlog::debug("{}", path);
-		spdlog::debug("  offset: {}", offset);
+		entries.add(path, offset, size_real, size_compressed, 0);
+	}
 
-		if(uncompressed)
+	return true;
+}
+
+bool Unpacker::read_files_2945(xr_reader *reader, std::size_t archive_size, EntryTable& entries)
+{
+	while(!reader->eof())
+	{
+		std::string_view path = reader->skip_sz();
+		auto crc = reader->r_u32();
+		auto offset = reader->r_u32();
+		auto size_real = reader->r_u32();
+		auto size_compressed = reader->r_u32();
+
+		if(!IsInArchive(offset, size_compressed, archive_size))
 		{
-			spdlog::debug("  size (real): {}", size);
+			spdlog::error("Entry {} is out of the archive bounds", path);
+			return false;
 		}
-		else
+
+		entries.add(path, offset, size_real, size_compressed, crc);
+	}
+
+	return true;
+}
+
+bool Unpacker::read_files_2947(xr_reader *reader, std::size_t archive_size, EntryTable& entries)
+{
+	// records are roughly 50 bytes, a little over-reservation is cheaper than regrowing
+	entries.reserve(reader->size() / 40, reader->size());
+
+	while(!reader->eof())
+	{
+		auto name_size = reader->r_u16() - 16;                                  // unsigned 2 bytes <─┐
+		auto size_real = reader->r_u32();                                       // unsigned 4 bytes   │
+		auto size_compressed = reader->r_u32();                                 // unsigned 4 bytes   │
+		auto crc = reader->r_u32();                                             // unsigned 4 bytes   │
+		auto path = std::string_view(reader->skip<char>(name_size), name_size); // string   N bytes >─┘
+		auto offset = reader->r_u32();                                          // unsigned 4 bytes
+
+		if(!IsInArchive(offset, size_compressed, archive_size))
 		{
-			spdlog::debug("  size (compressed): {}", size);
+			spdlog::error("Entry {} is out of the archive bounds", path);
+			return false;
+		}
+
+		entries.add(path, offset, size_real, size_compressed, crc);
+	}
+
+	return true;
+}
+
+void Unpacker::extract_1114(const std::string& prefix, const PathFilter& filter, xr_reader *reader, const uint8_t *data, std::size_t data_size)
+{
+	xr_file_system& fs = xr_file_system::instance();
+	while(!reader->eof())
+	{
+		std::string_view raw_name = reader->skip_sz();
+		auto uncompressed = reader->r_u32();
+		auto offset = reader->r_u32();
+		auto size = reader->r_u32();
+
+		if(!IsInArchive(offset, size, data_size))
+		{
+			spdlog::error("Entry {} is out of the archive bounds", raw_name);
+			return;
+		}
+
+		// skipped entries never get a string of their own
+		if(offset != 0 && !filter.matches(raw_name))
+		{
+			continue;
+		}
+
+		std::string name(raw_name);
+		std::replace(name.begin(), name.end(), '\\', '/');
+		auto path = prefix + name;
+
+		if(spdlog::should_log(spdlog::level::debug))
+		{
+			spdlog::debug("{}", path);
+			spdlog::debug("  offset: {}", offset);
+
+			if(uncompressed)
+			{
+				spdlog::debug("  size (real): {}", size);
+			}
+			else
+			{
+				spdlog::debug("  size (compressed): {}", size);
+			}
 		}
 
 		if(fs.is_read_only())
@@ -166,9 +500,7 @@ void Unpacker::extract_1114(const std::string& prefix, const std::string& mask,
 			continue;
 		}
 
-		auto path_splitted = xr_file_system::split_path(path.append(name));
-		auto folder = path_splitted.folder;
-		fs.create_path(folder);
+		m_folders.create(fs, FolderCache::parent(path));
 
 		if(uncompressed)
 		{
@@ -176,42 +508,52 @@ void Unpacker::extract_1114(const std::string& prefix, const std::string& mask,
 		}
 		else
 		{
-			uint32_t real_size;
-			uint8_t *p;
-			xr_lzhuf::decompress(p, real_size, data + offset, size);
+			auto& pool = BufferPool::local();
+			auto real_size = xr_lzhuf::decompressed_size(data + offset, size);
+			auto buffer = pool.acquire(real_size);
 
-			if(real_size)
+			if(real_size && buffer.data)
 			{
-				write_file(fs, path, p, real_size);
+				xr_lzhuf::decompress_into(buffer.data, real_size, data + offset, size);
+				write_file(fs, path, buffer.data, real_size);
 			}
 
-			free(p);
+			pool.release(buffer);
 		}
 	}
 }
 
-void Unpacker::extract_2215(const std::string& prefix, const std::string& mask, xr_reader *reader, const uint8_t *data)
+void Unpacker::extract_2215(const std::string& prefix, const PathFilter& filter, xr_reader *reader, const uint8_t *data, std::size_t data_size)
 {
 	xr_file_system& fs = xr_file_system::instance();
 	while(!reader->eof())
 	{
-		std::string path;
-		reader->r_sz(path);
-		std::replace(path.begin(), path.end(), '\\', '/');
-
+		std::string_view raw_path = reader->skip_sz();
 		auto offset = reader->r_u32();
 		auto size_real = reader->r_u32();
 		auto size_compressed = reader->r_u32();
 
-		if(mask.length() > 0 && offset != 0 && path.find(mask) == std::string::npos)
+		if(!IsInArchive(offset, size_compressed, data_size))
+		{
+			spdlog::error("Entry {} is out of the archive bounds", raw_path);
+			return;
+		}
+
+		if(offset != 0 && !filter.matches(raw_path))
 		{
 			continue;
 		}
 
-		spdlog::debug("{}", path);
-		spdlog::debug("  offset: {}", offset);
-		spdlog::debug("  size (real): {}", size_real);
-		spdlog::debug("  size (compressed): {}", size_compressed);
+		std::string path(raw_path);
+		std::replace(path.begin(), path.end(), '\\', '/');
+
+		if(spdlog::should_log(spdlog::level::debug))
+		{
+			spdlog::debug("{}", path);
+			spdlog::debug("  offset: {}", offset);
+			spdlog::debug("  size (real): {}", size_real);
+			spdlog::debug("  size (compressed): {}", size_compressed);
+		}
 
 		if(fs.is_read_only())
 		{
@@ -220,7 +562,7 @@ void Unpacker::extract_2215(const std::string& prefix, const std::string& mask,
 
 		if(offset == 0)
 		{
-			fs.create_folder(prefix + path);
+			m_folders.create(fs, prefix + path);
 		}
 		else
 		{
@@ -229,104 +571,291 @@ void Unpacker::extract_2215(const std::string& prefix, const std::string& mask,
 	}
 }
 
-void Unpacker::extract_2945(const std::string& prefix, const std::string& mask, xr_reader *reader, const uint8_t *data)
+void Unpacker::extract_2945(const std::string& prefix, const PathFilter& filter, const EntryTable& entries, const uint8_t *data)
 {
 	xr_file_system& fs = xr_file_system::instance();
-	while(!reader->eof())
+	for(std::size_t i = 0; i < entries.size(); i++)
 	{
-		std::string path;
-		reader->r_sz(path);
-		std::replace(path.begin(), path.end(), '\\', '/');
-
-		auto crc = reader->r_u32();
-		auto offset = reader->r_u32();
-		auto size_real = reader->r_u32();
-		auto size_compressed = reader->r_u32();
-
-		if(mask.length() > 0 && offset != 0 && path.find(mask) == std::string::npos)
+		auto path = entries.path(i);
+		if(!entries.is_folder(i) && !filter.matches(path))
 		{
 			continue;
 		}
 
-		spdlog::debug("{}", path);
-		spdlog::debug("  crc: {0:#x}", crc);
-		spdlog::debug("  offset: {}", offset);
-		spdlog::debug("  size (real): {}", size_real);
-		spdlog::debug("  size (compressed): {}", size_compressed);
+		if(spdlog::should_log(spdlog::level::debug))
+		{
+			spdlog::debug("{}", path);
+			spdlog::debug("  crc: {0:#x}", entries.crc(i));
+			spdlog::debug("  offset: {}", entries.offset(i));
+			spdlog::debug("  size (real): {}", entries.size_real(i));
+			spdlog::debug("  size (compressed): {}", entries.size_compressed(i));
+		}
 
 		if(fs.is_read_only())
 		{
 			continue;
 		}
 
-		if(offset == 0)
+		auto full_path = prefix + std::string(path);
+		if(entries.is_folder(i))
 		{
-			fs.create_folder(prefix + path);
+			m_folders.create(fs, full_path);
 		}
 		else
 		{
-			write_file(fs, prefix + path, data + offset, size_real, size_compressed);
+			write_file(fs, full_path, data + entries.offset(i), entries.size_real(i), entries.size_compressed(i));
 		}
 	}
 }
 
-void Unpacker::extract_2947(const std::string& prefix, const std::string& mask, xr_reader *reader, const uint8_t *data)
+void Unpacker::extract_2947(const std::string& prefix, const PathFilter& filter, const EntryTable& entries, const uint8_t *data)
 {
 	xr_file_system& fs = xr_file_system::instance();
-	while(!reader->eof())
-	{
-		auto name_size = reader->r_u16() - 16;                      // unsigned 2 bytes <─┐
-		auto size_real = reader->r_u32();                           // unsigned 4 bytes   │
-		auto size_compressed = reader->r_u32();                     // unsigned 4 bytes   │
-		auto crc = reader->r_u32();                                 // unsigned 4 bytes   │
-		std::string name(reader->skip<char>(name_size), name_size); // string   N bytes >─┘
-		auto offset = reader->r_u32();                              // unsigned 4 bytes
+	std::vector<uint32_t> files;
 
-		std::replace(name.begin(), name.end(), '\\', '/');
-		auto path = prefix + name;
+	for(std::size_t i = 0; i < entries.size(); i++)
+	{
+		auto path = entries.path(i);
 
-		if(mask.length() > 0 && offset != 0 && path.find(mask) == std::string::npos)
+		if(!entries.is_folder(i) && !filter.matches(path))
 		{
 			continue;
 		}
 
-		spdlog::debug("{}", name);
-		spdlog::debug("  offset: {}", offset);
+		if(spdlog::should_log(spdlog::level::debug))
+		{
+			spdlog::debug("{}", path);
+			spdlog::debug("  offset: {}", entries.offset(i));
+
+			if(entries.is_compressed(i))
+			{
+				spdlog::debug("  size (real): {}", entries.size_real(i));
+				spdlog::debug("  size (compressed): {}", entries.size_compressed(i));
+			}
+			else
+			{
+				spdlog::debug("  size: {}", entries.size_real(i));
+			}
+
+			spdlog::debug("  crc: {0:#x}", entries.crc(i));
+		}
+
+		if(fs.is_read_only())
+		{
+			continue;
+		}
 
-		if(size_real != size_compressed)
+		if(entries.is_folder(i))
 		{
-			spdlog::debug("  size (real): {}", size_real);
-			spdlog::debug("  size (compressed): {}", size_compressed);
+			auto full_path = prefix + std::string(path);
+			m_folders.create(fs, full_path);
+			Progress::file("{}", full_path);
 		}
 		else
 		{
-			spdlog::debug("  size: {}", size_real);
+			files.push_back(static_cast<uint32_t>(i));
 		}
+	}
 
-		spdlog::debug("  crc: {0:#x}", crc);
+	extract_files(fs, prefix, entries, files, data);
+}
 
-		if(fs.is_read_only())
+void Unpacker::extract_files(xr_file_system& fs, const std::string& prefix, const EntryTable& entries, const std::vector<uint32_t>& files, const uint8_t *data)
+{
+	auto jobs = ThreadPool::resolve_jobs(m_jobs);
+
+	auto use_io_uring = fs.use_io_uring();
+	if(use_io_uring && !xr_uring_writer_posix::is_supported())
+	{
+		spdlog::warn("io_uring is not available, falling back to synchronous writes");
+		use_io_uring = false;
+	}
+
+	// folder entries are already created, but archives don't always have them, so build
+	// the rest of the tree before writing. It keeps workers from racing each other in
+	// create_path, io_uring writes bypass it anyway and the per-file checks become lookups.
+	std::string folder(prefix);
+	for(auto entry : files)
+	{
+		folder.resize(prefix.size());
+		folder.append(FolderCache::parent(entries.path(entry)));
+		if(!m_folders.create(fs, folder))
 		{
-			continue;
+			spdlog::error("Failed to create folder {}", folder);
 		}
+	}
 
-		if(offset == 0)
+	if(jobs > 1 || use_io_uring)
+	{
+		spdlog::info("Extracting {} files using {} threads{}", files.size(), jobs, use_io_uring ? " and io_uring" : "");
+	}
+
+	uint64_t total_bytes = 0;
+	for(auto entry : files)
+	{
+		total_bytes += entries.size_real(entry);
+	}
+
+	Progress progress("Extracted", files.size(), total_bytes);
+	std::vector<std::string> errors(files.size());
+
+	if(use_io_uring)
+	{
+		// every task gets its own ring and keeps up to its queue depth of files in flight
+		constexpr std::size_t batch_size = 256;
+		auto batches = (files.size() + batch_size - 1) / batch_size;
+
+		ThreadPool pool(std::min(jobs, std::max<std::size_t>(batches, 1)));
+		pool.parallel_for(batches, [&](std::size_t batch)
 		{
-			fs.create_path(path);
-			spdlog::info("{}", path);
+			auto begin = batch * batch_size;
+			auto end = std::min(files.size(), begin + batch_size);
+
+			// files before next are handed to the writer, it reports each of them through on_complete
+			auto next = begin;
+			try
+			{
+				xr_uring_writer_posix writer;
+				for(; next < end; next++)
+				{
+					auto i = next;
+					auto entry = files[i];
+					auto size_real = entries.size_real(entry);
+					auto src = data + entries.offset(entry);
+
+					// completions run on this thread as well, so the buffer goes back to the same pool
+					BufferPool::Buffer buffer;
+					if(entries.is_compressed(entry))
+					{
+						buffer = BufferPool::local().acquire(size_real);
+						if(!buffer.data || !LZOCodec::decompress(buffer.data, size_real, src, entries.size_compressed(entry)))
+						{
+							BufferPool::local().release(buffer);
+							errors[i] = "decompression failed";
+							continue;
+						}
+						src = buffer.data;
+					}
+
+					std::string name;
+					auto path = prefix + std::string(entries.path(entry));
+					auto folder = open_folder(path, name);
+
+					// the folder handle lives in the callback, so its descriptor stays open until the file is
+					auto on_complete = [&, i, folder, buffer](int error) mutable
+					{
+						BufferPool::local().release(buffer);
+
+						if(error != 0)
+						{
+							errors[i] = fmt::format("{} (errno={})", strerror(error), error);
+						}
+						else
+						{
+							Progress::file("{}{}", prefix, entries.path(files[i]));
+							progress.advance(entries.size_real(files[i]));
+						}
+					};
+
+					if(folder)
+					{
+						writer.write_file(*folder, name, src, size_real, std::move(on_complete));
+					}
+					else
+					{
+						writer.write_file(path, src, size_real, std::move(on_complete));
+					}
+				}
+				writer.wait();
+			}
+			catch(const std::exception& e)
+			{
+				for(auto i = next; i < end; i++)
+				{
+					if(errors[i].empty())
+					{
+						errors[i] = e.what();
+					}
+				}
+			}
+		});
+	}
+	else
+	{
+		ThreadPool pool(std::min(jobs, std::max<std::size_t>(files.size(), 1)));
+		pool.parallel_for(files.size(), [&](std::size_t i)
+		{
+			auto entry = files[i];
+			auto path = prefix + std::string(entries.path(entry));
+			try
+			{
+				if(write_file(fs, path, data + entries.offset(entry), entries.size_real(entry), entries.size_compressed(entry)))
+				{
+					Progress::file("{}", path);
+					progress.advance(entries.size_real(entry));
+				}
+				else
+				{
+					errors[i] = "extraction failed";
+				}
+			}
+			catch(const std::exception& e)
+			{
+				errors[i] = e.what();
+			}
+		});
+	}
+
+	progress.finish();
+
+	std::size_t failed = std::count_if(errors.begin(), errors.end(), [](const auto& error) { return !error.empty(); });
+	if(failed != 0)
+	{
+		spdlog::error("Failed to extract {} of {} files:", failed, files.size());
+		for(std::size_t i = 0; i < files.size(); i++)
+		{
+			if(!errors[i].empty())
+			{
+				spdlog::error("  {}{}: {}", prefix, entries.path(files[i]), errors[i]);
+			}
 		}
-		else
+	}
+}
+
+FolderHandles::Handle Unpacker::open_folder(const std::string& path, std::string& name)
+{
+	auto separator = path.rfind('/');
+	if(separator == std::string::npos || separator == 0)
+	{
+		return nullptr;
+	}
+
+	auto folder = m_folder_handles.open(path.substr(0, separator));
+	if(folder)
+	{
+		name = path.substr(separator + 1);
+	}
+
+	return folder;
+}
+
+xr_writer* Unpacker::open_file(xr_file_system& fs, const std::string& path)
+{
+	std::string name;
+	if(!fs.is_read_only())
+	{
+		if(auto folder = open_folder(path, name))
 		{
-			write_file(fs, path, data + offset, size_real, size_compressed);
-			static std::size_t file_counter = 0;
-			spdlog::info("[{}] {}", ++file_counter, path);
+			return fs.w_open_at(*folder, name);
 		}
 	}
+
+	return fs.w_open(path);
 }
 
 bool Unpacker::write_file(xr_file_system& fs, const std::string& path, const void *data, std::size_t size)
 {
-	auto w = fs.w_open(path);
+	auto w = open_file(fs, path);
 	if(w)
 	{
 		w->w_raw(data, size);
@@ -340,37 +869,59 @@ bool Unpacker::write_file(xr_file_system& fs, const std::string& path, const voi
 
 bool Unpacker::write_file(xr_file_system& fs, const std::string& path, const uint8_t *data, uint32_t size_real, uint32_t size_compressed)
 {
+	auto& pool = BufferPool::local();
+	BufferPool::Buffer buffer;
+
 	if(size_real != size_compressed)
 	{
-		lzo_uint size = size_real;
-		auto temp = new uint8_t[size];
-		if(lzo1x_decompress_safe(data, size_compressed, temp, &size, nullptr) != LZO_E_OK)
+		buffer = pool.acquire(size_real);
+		if(!buffer.data || !LZOCodec::decompress(buffer.data, size_real, data, size_compressed))
 		{
-			delete[] temp;
+			spdlog::error("Failed to decompress file \"{}\"", path);
+			pool.release(buffer);
 			return false;
 		}
-		data = temp;
-		size_real = uint32_t(size & UINT32_MAX);
+		data = buffer.data;
 	}
 
-	auto folder = xr_file_system::split_path(path).folder;
+	auto folder = FolderCache::parent(path);
 
-	if(!fs.create_path(folder))
+	if(!m_folders.create(fs, folder))
 	{
 		spdlog::error("Failed to create folder {}", folder);
+		pool.release(buffer);
 		return false;
 	}
 
-	if((!fs.is_read_only() && !write_file(fs, path, data, size_real)) || (fs.is_read_only() && !fs.file_exist(path)))
+	auto is_written = size_real == size_compressed ? copy_file(fs, path, data, size_real) : write_file(fs, path, data, size_real);
+	pool.release(buffer);
+
+	if((!fs.is_read_only() && !is_written) || (fs.is_read_only() && !fs.file_exist(path)))
 	{
 		spdlog::error("Failed to open file \"{}\": {} (errno={}) ", path, strerror(errno), errno);
 		return false;
 	}
 
-	if(size_real != size_compressed)
+	return true;
+}
+
+bool Unpacker::copy_file(xr_file_system& fs, const std::string& path, const uint8_t *data, std::size_t size)
+{
+	if(m_archive_fd == -1 || data < m_archive_data)
 	{
-		delete[] data;
+		return write_file(fs, path, data, size);
 	}
 
-	return true;
+	auto w = open_file(fs, path);
+	if(w)
+	{
+		// whatever the kernel couldn't copy is written from the mapping
+		auto copied = w->w_file_range(m_archive_fd, static_cast<std::size_t>(data - m_archive_data), size);
+		w->w_raw(data + copied, size - copied);
+		fs.w_close(w);
+
+		return true;
+	}
+
+	return false;
 }
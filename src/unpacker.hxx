@@ -1,8 +1,13 @@
 #pragma once
 
+#include "entry_table.hxx"
+#include "folder_cache.hxx"
+#include "folder_handles.hxx"
+#include "path_filter.hxx"
 #include "xray_re/xr_types.hxx"
 
 #include <string>
+#include <vector>
 
 namespace xray_re
 {
@@ -16,14 +21,47 @@ class Unpacker
 public:
 	~Unpacker() = default;
 
-	void process(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const std::string& filter, bool is_read_only);
+	void process(const std::string& source_path, const std::string& destination_path, const xray_re::DBVersion& version, const PathFilter& filter, bool is_read_only, std::size_t jobs = 1);
+
+	// checks crc of every entry without writing anything, returns false if any of them is damaged.
+	// Paths of the damaged entries are stored in damaged when it is given.
+	static bool verify(const std::string& source_path, const xray_re::DBVersion& version, std::size_t jobs = 1, std::vector<std::string> *damaged = nullptr);
+
+	// parsed header of any format, taken from the index cache when it is enabled and up to date.
+	// 1114 and 2215 headers carry no crc, it is 0 for their entries.
+	static bool read_files(const std::string& source_path, xray_re::xr_reader *reader, const xray_re::DBVersion& version, EntryTable& entries);
 
 private:
-	static void extract_1114(const std::string& prefix, const std::string& mask, xray_re::xr_reader *reader, const uint8_t *data);
-	static void extract_2215(const std::string& prefix, const std::string& mask, xray_re::xr_reader *reader, const uint8_t *data);
-	static void extract_2945(const std::string& prefix, const std::string& mask, xray_re::xr_reader *reader, const uint8_t *data);
-	static void extract_2947(const std::string& prefix, const std::string& mask, xray_re::xr_reader *reader, const uint8_t *data);
+	static xray_re::xr_reader* open_header(xray_re::xr_reader *reader, const xray_re::DBVersion& version);
+	// false if an entry points past the end of the archive
+	static bool read_files_1114(xray_re::xr_reader *reader, const uint8_t *data, std::size_t archive_size, EntryTable& entries);
+	static bool read_files_2215(xray_re::xr_reader *reader, std::size_t archive_size, EntryTable& entries);
+	static bool read_files_2945(xray_re::xr_reader *reader, std::size_t archive_size, EntryTable& entries);
+	static bool read_files_2947(xray_re::xr_reader *reader, std::size_t archive_size, EntryTable& entries);
+
+	void extract_1114(const std::string& prefix, const PathFilter& filter, xray_re::xr_reader *reader, const uint8_t *data, std::size_t data_size);
+	void extract_2215(const std::string& prefix, const PathFilter& filter, xray_re::xr_reader *reader, const uint8_t *data, std::size_t data_size);
+	void extract_2945(const std::string& prefix, const PathFilter& filter, const EntryTable& entries, const uint8_t *data);
+	void extract_2947(const std::string& prefix, const PathFilter& filter, const EntryTable& entries, const uint8_t *data);
+
+	void extract_files(xray_re::xr_file_system& fs, const std::string& prefix, const EntryTable& entries, const std::vector<uint32_t>& files, const uint8_t *data);
+
+	// descriptor of the folder holding path and the name of the file in it, nullptr if path has to be used as is
+	FolderHandles::Handle open_folder(const std::string& path, std::string& name);
+	xray_re::xr_writer* open_file(xray_re::xr_file_system& fs, const std::string& path);
+
+	bool write_file(xray_re::xr_file_system& fs, const std::string& path, const void *data, std::size_t size);
+	bool write_file(xray_re::xr_file_system& fs, const std::string& path, const uint8_t *data, uint32_t size_real, uint32_t size_compressed);
+	bool copy_file(xray_re::xr_file_system& fs, const std::string& path, const uint8_t *data, std::size_t size);
+
+	std::size_t m_jobs{1};
+
+	// folders known to exist in the destination, every one of them is created once
+	FolderCache m_folders;
+	// descriptors of the folders files are being extracted to, outputs are opened relative to them
+	FolderHandles m_folder_handles;
 
-	static bool write_file(xray_re::xr_file_system& fs, const std::string& path, const void *data, std::size_t size);
-	static bool write_file(xray_re::xr_file_system& fs, const std::string& path, const uint8_t *data, uint32_t size_real, uint32_t size_compressed);
+	// descriptor and mapping of the archive, stored entries are copied from it in kernel
+	int m_archive_fd{-1};
+	const uint8_t *m_archive_data{nullptr};
 };
\ No newline at end of file
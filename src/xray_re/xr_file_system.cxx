@@ -29,7 +29,7 @@ std::string PathAlias::to_string() const
 	return "{path=" + path + ", root=" + root + ", filter=" + filter + ", caption=" + caption + "}";
 }
 
-xr_file_system::xr_file_system()
+xr_file_system::xr_file_system() : m_write_buffer_size(xr_file_writer_posix::DEFAULT_BUFFER_SIZE)
 {
 	add_path_alias(PA_FS_ROOT, "", "");
 }
@@ -50,6 +50,26 @@ void xr_file_system::set_read_only(bool is_read_only)
 	m_is_read_only = is_read_only;
 }
 
+std::size_t xr_file_system::write_buffer_size() const
+{
+	return m_write_buffer_size;
+}
+
+void xr_file_system::set_write_buffer_size(std::size_t size)
+{
+	m_write_buffer_size = size;
+}
+
+bool xr_file_system::use_io_uring() const
+{
+	return m_use_io_uring;
+}
+
+void xr_file_system::set_use_io_uring(bool use_io_uring)
+{
+	m_use_io_uring = use_io_uring;
+}
+
 xr_reader* xr_file_system::r_open(const std::string& path)
 {
 	spdlog::debug("r_open: path={}", path);
@@ -92,7 +112,7 @@ xr_writer* xr_file_system::w_open(const std::string& path, bool ignore_ro) const
 		return new xr_fake_writer();
 	}
 
-	return new xr_file_writer_posix(path);
+	return new xr_file_writer_posix(path, m_write_buffer_size);
 }
 
 xr_writer* xr_file_system::w_open(const std::string& path, const std::string& name,  bool ignore_ro) const
@@ -107,6 +127,17 @@ xr_writer* xr_file_system::w_open(const std::string& path, const std::string& na
 	return w_open(pa->root + name, ignore_ro);
 }
 
+xr_writer* xr_file_system::w_open_at(int dirfd, const std::string& name, bool ignore_ro) const
+{
+	spdlog::debug("w_open_at: dirfd={}, name={}, ignore_ro={}", dirfd, name, ignore_ro);
+	if(!ignore_ro && is_read_only())
+	{
+		return new xr_fake_writer();
+	}
+
+	return new xr_file_writer_posix(dirfd, name, m_write_buffer_size);
+}
+
 void xr_file_system::w_close(xr_writer *&writer)
 {
 	delete writer;
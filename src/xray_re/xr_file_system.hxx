@@ -36,12 +36,17 @@ namespace xray_re
 
 		bool is_read_only() const;
 		void set_read_only(bool is_read_only);
+		std::size_t write_buffer_size() const;
+		void set_write_buffer_size(std::size_t size);
+		bool use_io_uring() const;
+		void set_use_io_uring(bool use_io_uring);
 
 		static xr_reader* r_open(const std::string& path);
 		xr_reader* r_open(const std::string& path, const std::string& name) const;
 		static void r_close(xr_reader*& reader);
 		xr_writer* w_open(const std::string& path, bool ignore_ro = false) const;
 		xr_writer* w_open(const std::string& path, const std::string& name, bool ignore_ro = false) const;
+		xr_writer* w_open_at(int dirfd, const std::string& name, bool ignore_ro = false) const;
 		static void w_close(xr_writer*& writer);
 
 		bool copy_file(const std::string& src_path, const std::string& src_name, const std::string& dst_path, const std::string& tgt_name = nullptr) const;
@@ -63,5 +68,7 @@ namespace xray_re
 
 		std::vector<PathAlias> m_aliases;
 		bool m_is_read_only{false};
+		std::size_t m_write_buffer_size;
+		bool m_use_io_uring{false};
 	};
 } // namespace xray_re
@@ -1,25 +1,32 @@
 #include "xr_file_writer_posix.hxx"
+#include "xr_metrics.hxx"
 #include "xr_utils.hxx"
 
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <filesystem>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 using namespace xray_re;
 
-xr_file_writer_posix::xr_file_writer_posix(const std::string& path)
+xr_file_writer_posix::xr_file_writer_posix(const std::string& path, std::size_t buffer_size) :
+	xr_file_writer_posix(AT_FDCWD, path, buffer_size) {}
+
+xr_file_writer_posix::xr_file_writer_posix(int dirfd, const std::string& name, std::size_t buffer_size) : m_buffer_size(buffer_size)
 {
-	m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+	xr_metrics::scoped_timer timer(xr_metrics::FILE_OPEN);
+	m_fd = ::openat(dirfd, name.c_str(), O_RDWR | O_CREAT, 0666);
 	if(m_fd == -1)
 	{
-		throw std::runtime_error(fmt::format("Failed to open file {}: {} (errno={}) ", path, strerror(errno), errno));
+		throw std::runtime_error(fmt::format("Failed to open file {}: {} (errno={}) ", name, strerror(errno), errno));
 	}
 }
 
@@ -27,6 +34,9 @@ xr_file_writer_posix::~xr_file_writer_posix()
 {
 	assert(m_fd != -1);
 
+	flush();
+
+	xr_metrics::scoped_timer timer(xr_metrics::FILE_CLOSE);
 	auto res = ::close(m_fd);
 	if(res == -1)
 	{
@@ -36,33 +46,158 @@ xr_file_writer_posix::~xr_file_writer_posix()
 
 void xr_file_writer_posix::w_raw(const void *data, std::size_t length)
 {
-	auto res = ::write(m_fd, data, length);
+	if(length == 0)
+	{
+		return;
+	}
 
-	if(length != 0 && data != MAP_FAILED)
+	// Position is tracked here instead of asking the kernel, so seek() and tell() are free
+	// and small writes (chunk headers, close_chunk size patches) are merged in the buffer.
+	auto buffer_end = m_buffer_pos + m_buffer.size();
+	if(m_pos >= m_buffer_pos && m_pos <= buffer_end && m_pos + length <= m_buffer_pos + m_buffer_size)
 	{
-		if(res == -1)
+		auto offset = m_pos - m_buffer_pos;
+		if(offset + length > m_buffer.size())
 		{
-			spdlog::error("Failed to write to descriptor {}: {} (errno={}) ", m_fd, strerror(errno), errno);
+			m_buffer.resize(offset + length);
 		}
 
-		assert(static_cast<std::size_t>(res) == length);
+		std::memcpy(m_buffer.data() + offset, data, length);
+		m_pos += length;
+		return;
+	}
+
+	flush();
+
+	if(length >= m_buffer_size)
+	{
+		write_at(data, length, m_pos);
+		m_pos += length;
+		m_buffer_pos = m_pos;
+		return;
 	}
+
+	m_buffer_pos = m_pos;
+	m_buffer.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + length);
+	m_pos += length;
 }
 
 void xr_file_writer_posix::seek(std::size_t pos)
 {
-	auto res = ::lseek64(m_fd, static_cast<off_t>(pos), SEEK_SET);
-
-	assert(static_cast<std::size_t>(res) == pos);
+	m_pos = pos;
 }
 
 std::size_t xr_file_writer_posix::tell()
 {
-	auto res = ::lseek64(m_fd, 0, SEEK_CUR);
-	if(res == -1)
+	return m_pos;
+}
+
+std::size_t xr_file_writer_posix::w_file_range(int fd, std::size_t offset, std::size_t size)
+{
+	// once a syscall turns out to be unsupported (old kernel, file system) don't try it again
+	static std::atomic<bool> copy_file_range_supported{true};
+	static std::atomic<bool> sendfile_supported{true};
+
+	flush();
+
+	xr_metrics::scoped_timer timer(xr_metrics::FILE_WRITE);
+
+	auto src_pos = static_cast<loff_t>(offset);
+	auto dst_pos = static_cast<loff_t>(m_pos);
+	std::size_t copied = 0;
+
+	while(copied < size && copy_file_range_supported)
 	{
-		spdlog::error("Failed to close file descriptor {}: {} (errno={}) ", m_fd, strerror(errno), errno);
+		auto res = ::copy_file_range(fd, &src_pos, m_fd, &dst_pos, size - copied, 0);
+		if(res > 0)
+		{
+			copied += static_cast<std::size_t>(res);
+			continue;
+		}
+
+		if(res == -1 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(res == -1 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EPERM))
+		{
+			spdlog::debug("copy_file_range is not usable: {} (errno={}) ", strerror(errno), errno);
+			copy_file_range_supported = false;
+		}
+		break;
+	}
+
+	// sendfile writes at the current file offset of the destination
+	if(copied < size && sendfile_supported && ::lseek64(m_fd, dst_pos, SEEK_SET) == dst_pos)
+	{
+		auto src_offset = static_cast<off_t>(src_pos);
+		while(copied < size)
+		{
+			auto res = ::sendfile(m_fd, fd, &src_offset, size - copied);
+			if(res > 0)
+			{
+				copied += static_cast<std::size_t>(res);
+				continue;
+			}
+
+			if(res == -1 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if(res == -1 && (errno == ENOSYS || errno == EINVAL))
+			{
+				spdlog::debug("sendfile is not usable: {} (errno={}) ", strerror(errno), errno);
+				sendfile_supported = false;
+			}
+			break;
+		}
+	}
+
+	m_pos += copied;
+	m_buffer_pos = m_pos;
+	timer.set_bytes(copied);
+	return copied;
+}
+
+bool xr_file_writer_posix::sync()
+{
+	flush();
+	return !m_failed;
+}
+
+void xr_file_writer_posix::flush()
+{
+	if(!m_buffer.empty())
+	{
+		write_at(m_buffer.data(), m_buffer.size(), m_buffer_pos);
+		m_buffer.clear();
 	}
+}
+
+void xr_file_writer_posix::write_at(const void *data, std::size_t length, std::size_t pos)
+{
+	xr_metrics::scoped_timer timer(xr_metrics::FILE_WRITE, length);
+
+	auto p = static_cast<const uint8_t*>(data);
+	while(length != 0)
+	{
+		auto res = ::pwrite64(m_fd, p, length, static_cast<off64_t>(pos));
+		if(res == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
 
-	return static_cast<std::size_t>(res);
+			spdlog::error("Failed to write to descriptor {}: {} (errno={}) ", m_fd, strerror(errno), errno);
+			m_failed = true;
+			return;
+		}
+
+		p += res;
+		pos += static_cast<std::size_t>(res);
+		length -= static_cast<std::size_t>(res);
+	}
 }
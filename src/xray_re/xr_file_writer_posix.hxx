@@ -4,19 +4,41 @@
 #include "xr_writer.hxx"
 
 #include <string>
+#include <vector>
 
 namespace xray_re
 {
 	class xr_file_writer_posix: public xr_writer
 	{
 	public:
-		explicit xr_file_writer_posix(const std::string& path);
+		enum
+		{
+			DEFAULT_BUFFER_SIZE = 256*1024
+		};
+
+		// buffer_size == 0 disables buffering, every w_raw goes straight to the file
+		explicit xr_file_writer_posix(const std::string& path, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+		// name is resolved relative to the folder descriptor dirfd, see openat(2)
+		xr_file_writer_posix(int dirfd, const std::string& name, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
 		~xr_file_writer_posix() override;
 		void w_raw(const void *data, std::size_t length) override;
 		void seek(std::size_t pos) override;
 		std::size_t tell() override;
+		std::size_t w_file_range(int fd, std::size_t offset, std::size_t size) override;
+		bool sync() override;
+
+		void flush();
 
 	private:
+		void write_at(const void *data, std::size_t length, std::size_t pos);
+
 		int m_fd{-1};
+		std::size_t m_pos{0};
+		bool m_failed{false};
+
+		// file offset of m_buffer[0]
+		std::size_t m_buffer_pos{0};
+		std::size_t m_buffer_size{0};
+		std::vector<uint8_t> m_buffer;
 	};
 } // namespace xray_re
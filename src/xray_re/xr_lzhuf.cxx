@@ -11,158 +11,77 @@ All rights reserved. Permission granted for non-commercial use.
 */
 
 #include "xr_lzhuf.hxx"
+#include "xr_metrics.hxx"
 
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
 
 using namespace xray_re;
 
-void _lzhuf::InitTree()
+// Matches are searched with hash chains instead of the original binary trees. Every position still
+// has to be inserted, but a lookup is only done where a symbol is emitted and stops after MAX_CHAIN
+// candidates, which is much cheaper on the long repetitive paths of archive headers.
+uint32_t xr_lzhuf_context::Hash(uint32_t pos) const
 {
-	for(int i = N + 1; i <= N + 256; i++)
-	{
-		rson[i] = NIL; // Root
-	}
-
-	for(int i = 0; i < N; i++)
-	{
-		dad[i] = NIL; // Node
-	}
+	auto p = &m_window[pos];
+	auto value = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16;
+	return (value * 2654435761u) >> (32 - HASH_BITS);
 }
 
-void _lzhuf::InsertNode(int r)
+void xr_lzhuf_context::InsertString(uint32_t pos)
 {
-	auto cmp = 1;
-	auto key = &text_buf[r];
-	auto p = N + 1 + key[0];
-	rson[r] = lson[r] = NIL;
-	match_length = 0;
-	while(true)
-	{
-		if(cmp >= 0)
-		{
-			if(rson[p] != NIL)
-			{
-				p = rson[p];
-			}
-			else
-			{
-				rson[p] = r;
-				dad[r] = p;
-				return;
-			}
-		}
-		else
-		{
-			if(lson[p] != NIL)
-			{
-				p = lson[p];
-			}
-			else
-			{
-				lson[p] = r;
-				dad[r] = p;
-				return;
-			}
-		}
-
-		uint32_t i;
-		for(i = 1; i < F; i++)
-		{
-			if((cmp = key[i] - text_buf[p + i]) != 0)
-			{
-				break;
-			}
-		}
-
-		if(i > THRESHOLD)
-		{
-			if(i > match_length)
-			{
-				match_position = ((r - p) & (N - 1)) - 1;
-				if((match_length = i) >= F) // ????
-				{
-					break;
-				}
-			}
-			if(i == match_length)
-			{
-				int c = ((r - p) & (N - 1)) - 1;
-				if(c  < match_position)
-				{
-					match_position = c;
-				}
-			}
-		}
-	}
-	dad[r] = dad[p];
-	lson[r] = lson[p];
-	rson[r] = rson[p];
-	dad[lson[p]] = r;
-	dad[rson[p]] = r;
-
-	if(rson[dad[p]] == p)
-	{
-		rson[dad[p]] = r;
-	}
-	else
+	if(pos + THRESHOLD >= m_window.size())
 	{
-		lson[dad[p]] = r;
+		return; // too close to the end to start a match
 	}
 
-	dad[p] = NIL;  // Remove p
+	auto hash = Hash(pos);
+	m_prev[pos & (N - 1)] = m_head[hash];
+	m_head[hash] = pos;
 }
 
-void _lzhuf::DeleteNode(int p)
+// Returns the length of the longest match for pos (0 if it is not longer than THRESHOLD).
+// On equal lengths the nearest match wins since it has the shortest position code.
+uint32_t xr_lzhuf_context::FindMatch(uint32_t pos, uint32_t& distance) const
 {
-	int q;
-
-	if(dad[p] == NIL)
+	auto max_length = std::min<uint32_t>(F, static_cast<uint32_t>(m_window.size()) - pos);
+	if(max_length <= THRESHOLD)
 	{
-		return; // Not registered
+		return 0;
 	}
 
-	if(rson[p] == NIL)
-	{
-		q = lson[p];
-	}
-	else if(lson[p] == NIL)
-	{
-		q = rson[p];
-	}
-	else
+	auto current = &m_window[pos];
+	uint32_t best_length = THRESHOLD;
+	auto candidate = m_head[Hash(pos)];
+
+	for(int chain = MAX_CHAIN; candidate != NO_POS && pos - candidate <= WINDOW && chain > 0; chain--)
 	{
-		q = lson[p];
-		if(rson[q] != NIL)
+		auto match = &m_window[candidate];
+		if(match[best_length] == current[best_length] && match[0] == current[0])
 		{
-			do
+			uint32_t length = 1;
+			while(length < max_length && match[length] == current[length])
 			{
-				q = rson[q];
+				length++;
 			}
-			while(rson[q] != NIL);
 
-			rson[dad[q]] = lson[q];
-			dad[lson[q]] = dad[q];
-			lson[q] = lson[p];
-			dad[lson[p]] = q;
+			if(length > best_length)
+			{
+				best_length = length;
+				distance = pos - candidate;
+				if(length == max_length)
+				{
+					break;
+				}
+			}
 		}
 
-		rson[q] = rson[p];
-		dad[rson[p]] = q;
+		candidate = m_prev[candidate & (N - 1)];
 	}
 
-	dad[q] = dad[p];
-
-	if(rson[dad[p]] == p)
-	{
-		rson[dad[p]] = q;
-	}
-	else
-	{
-		lson[dad[p]] = q;
-	}
-
-	dad[p] = NIL;
+	return best_length > THRESHOLD ? best_length : 0;
 }
 
 // Huffman coding
@@ -170,7 +89,7 @@ void _lzhuf::DeleteNode(int p)
 // Table for encoding and decoding the upper 6 bits of position
 
 // For encoding
-const std::array<uint8_t, 64> _lzhuf::p_len =
+const std::array<uint8_t, 64> xr_lzhuf_context::p_len =
 {
 	0x03, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05,
 	0x05, 0x05, 0x05, 0x05, 0x06, 0x06, 0x06, 0x06,
@@ -182,7 +101,7 @@ const std::array<uint8_t, 64> _lzhuf::p_len =
 	0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08
 };
 
-const std::array<uint8_t, 64> _lzhuf::p_code =
+const std::array<uint8_t, 64> xr_lzhuf_context::p_code =
 {
 	0x00, 0x20, 0x30, 0x40, 0x50, 0x58, 0x60, 0x68,
 	0x70, 0x78, 0x80, 0x88, 0x90, 0x94, 0x98, 0x9C,
@@ -195,7 +114,7 @@ const std::array<uint8_t, 64> _lzhuf::p_code =
 };
 
 // For decoding
-const std::array<uint8_t, 256> _lzhuf::d_code =
+const std::array<uint8_t, 256> xr_lzhuf_context::d_code =
 {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -231,7 +150,7 @@ const std::array<uint8_t, 256> _lzhuf::d_code =
 	0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
 };
 
-const std::array<uint8_t, 256> _lzhuf::d_len =
+const std::array<uint8_t, 256> xr_lzhuf_context::d_len =
 {
 	0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
 	0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
@@ -267,49 +186,27 @@ const std::array<uint8_t, 256> _lzhuf::d_len =
 	0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
 };
 
-int _lzhuf::GetBit()
+// Tops the bit buffer up to at least 57 bits, which covers a whole char code (the tree is never
+// deeper than ~22 levels since the root frequency is capped by MAX_FREQ) or a whole position code.
+// Bits past the end of the stream read as zeroes, like in the original implementation.
+void xr_lzhuf_context::FillBits()
 {
-	int i;
-
-	while(getlen <= 8)
+	while(m_bit_count <= 56)
 	{
-		if((i = getc()) < 0)
-		{
-			i = 0;
-		}
-
-		getbuf |= static_cast<unsigned int>(i << (8 - getlen));
-		getlen += 8;
+		uint64_t c = m_src_pos < m_src_limit ? m_src[m_src_pos++] : 0;
+		m_bits |= c << (56 - m_bit_count);
+		m_bit_count += 8;
 	}
-
-	i = static_cast<int>(getbuf);
-	getbuf <<= 1;
-	getlen--;
-
-	return (i >> 15) & 1;
 }
 
-int _lzhuf::GetByte()
+void xr_lzhuf_context::DropBits(uint32_t count)
 {
-	int i;
-
-	while(getlen <= 8)
-	{
-		int c = getc();
-		i = (c < 0) ? 0 : c;
-		getbuf |= static_cast<unsigned int>(i << (8 - getlen));
-		getlen += 8;
-	}
-
-	i = static_cast<int>(getbuf);
-	getbuf <<= 8;
-	getlen -= 8;
-
-	return (i & 0xff00) >> 8;
+	m_bits <<= count;
+	m_bit_count -= count;
 }
 
 // Output c bits of code
-void _lzhuf::Putcode(int l, unsigned int c)
+void xr_lzhuf_context::Putcode(int l, unsigned int c)
 {
 	putbuf |= c >> putlen;
 	if((putlen += l) >= 8)
@@ -330,7 +227,7 @@ void _lzhuf::Putcode(int l, unsigned int c)
 	}
 }
 
-void _lzhuf::StartHuff()
+void xr_lzhuf_context::StartHuff()
 {
 	for(int i = 0; i < N_CHAR; i++)
 	{
@@ -350,7 +247,7 @@ void _lzhuf::StartHuff()
 	prnt[R] = 0;
 }
 
-void _lzhuf::reconst()
+void xr_lzhuf_context::reconst()
 {
 	// Collect leaf nodes in the first half of the table and replace the freq by (freq + 1) / 2.
 	for(int i = 0, j = 0; i < T; i++)
@@ -393,7 +290,7 @@ void _lzhuf::reconst()
 
 
 // Increment frequency of given code by one, and update tree
-void _lzhuf::update(int c)
+void xr_lzhuf_context::update(int c)
 {
 	if(freq[R] == MAX_FREQ)
 	{
@@ -437,7 +334,7 @@ void _lzhuf::update(int c)
 	while((c = prnt[c]) != 0); // Repeat up to root
 }
 
-void _lzhuf::EncodeChar(unsigned int c)
+void xr_lzhuf_context::EncodeChar(unsigned int c)
 {
 	auto i = 0u;
 	auto j = 0;
@@ -464,7 +361,7 @@ void _lzhuf::EncodeChar(unsigned int c)
 	update(static_cast<int>(c));
 }
 
-void _lzhuf::EncodePosition(unsigned int c)
+void xr_lzhuf_context::EncodePosition(unsigned int c)
 {
 	// Output upper 6 bits by table lookup
 	auto i = c >> 6;
@@ -474,7 +371,7 @@ void _lzhuf::EncodePosition(unsigned int c)
 	Putcode(6, (c & 0x3f) << 10);
 }
 
-void _lzhuf::EncodeEnd()
+void xr_lzhuf_context::EncodeEnd()
 {
 	if(putlen)
 	{
@@ -483,184 +380,167 @@ void _lzhuf::EncodeEnd()
 	}
 }
 
-int _lzhuf::DecodeChar()
+int xr_lzhuf_context::DecodeChar()
 {
+	FillBits();
+
 	auto c = son[R];
+	auto bits = m_bits;
 
 	// Travel from root to leaf, choosing the smaller child node (son[]) if the read bit is 0, the bigger (son[]+1} if 1
+	uint32_t depth = 0;
 	while(c < T)
 	{
-		c += GetBit();
-		c = son[c];
+		c = son[c + static_cast<int>(bits >> 63)];
+		bits <<= 1;
+		depth++;
 	}
 
+	DropBits(depth);
+
 	c -= T;
 	update(c);
 	return c;
 }
 
-int _lzhuf::DecodePosition()
+int xr_lzhuf_context::DecodePosition()
 {
-	// recover upper 6 bits from table
-	auto i = GetByte();
-	auto c = d_code.at(i) << 6;
-	auto j = d_len.at(i);
-
-	// read lower 6 bits verbatim
-	j -= 2;
-	while(j--)
-	{
-		i = (i << 1) + GetBit();
-	}
-	return c | (i & 0x3f);
+	FillBits();
+
+	// recover upper 6 bits from table using the first byte, it also tells how many more bits
+	// belong to the code, and the lower 6 bits are the last ones of them
+	auto i = static_cast<unsigned int>(m_bits >> 56);
+	auto length = 8u + d_len[i] - 2u;
+	auto code = static_cast<unsigned int>(m_bits >> (64 - length));
+	DropBits(length);
+
+	return static_cast<int>(d_code[i] << 6 | (code & 0x3f));
 }
 
-void _lzhuf::Encode(uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize)
+void xr_lzhuf_context::Encode(uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize)
 {
-	int i, c, r, s;
-	uint32_t len;
+	xr_metrics::scoped_timer timer(xr_metrics::LZHUF_ENCODE, _textsize);
 
-	m_src_limit = _textsize;
-	m_src_pos = 0;
-	m_src = _text;
-
-	m_dest_limit = _textsize/2;
+	m_dest_limit = std::max<uint32_t>(_textsize / 2, 16);
 	m_dest_pos = 4;
 	m_dest = static_cast<uint8_t*>(malloc(m_dest_limit));
 	*(uint32_t*)m_dest = uint32_t(_textsize);
 
+	codesize = 0;
 	putbuf = 0;
 	putlen = 0;
 
 	StartHuff();
-	InitTree();
-	s = 0;
-	r = N - F;
-	for(i = s; i < r; i++)
-	{
-		text_buf[i] = ' ';
-	}
 
-	for(len = 0; len < F && (c = getc()) >= 0; len++)
-	{
-		text_buf[r + len] = static_cast<unsigned char>(c);
-	}
-
-	textsize = len;
+	// The decoder starts with N - F spaces in its ring buffer, so they are valid match sources too.
+	// Keeping the whole input behind them in one flat buffer avoids wrapping in the match finder.
+	m_window.assign(N - F, ' ');
+	m_window.insert(m_window.end(), _text, _text + _textsize);
+	std::fill(std::begin(m_head), std::end(m_head), NO_POS);
 
-	for(i = 1; i <= F; i++)
+	uint32_t pos = 0;
+	for(; pos < N - F; pos++)
 	{
-		InsertNode(r - i);
+		InsertString(pos);
 	}
 
-	InsertNode(r);
-
-	do
+	while(pos < m_window.size())
 	{
-		if(match_length > len)
-		{
-			match_length = len;
-		}
-		if(match_length <= THRESHOLD)
+		uint32_t distance = 0;
+		auto length = FindMatch(pos, distance);
+
+		if(length == 0)
 		{
-			match_length = 1;
-			EncodeChar(text_buf[r]);
+			EncodeChar(m_window[pos]);
+			length = 1;
 		}
 		else
 		{
-			EncodeChar(static_cast<unsigned int>(255 - THRESHOLD + match_length));
-			EncodePosition(static_cast<unsigned int>(match_position));
+			EncodeChar(static_cast<unsigned int>(255 - THRESHOLD + length));
+			EncodePosition(distance - 1);
 		}
 
-		auto last_match_length = match_length;
-		for(i = 0; i < last_match_length && (c = getc()) >= 0; i++)
+		for(auto end = pos + length; pos < end; pos++)
 		{
-			DeleteNode(s);
-			text_buf[s] = static_cast<unsigned char>(c);
-
-			if(s < F - 1)
-			{
-				text_buf[s + N] = static_cast<unsigned char>(c);
-			}
-
-			s = (s + 1) & (N - 1);
-			r = (r + 1) & (N - 1);
-			InsertNode(r);
-		}
-		while(i++ < last_match_length)
-		{
-			DeleteNode(s);
-			s = (s + 1) & (N - 1);
-			r = (r + 1) & (N - 1);
-
-			if(--len)
-			{
-				InsertNode(r);
-			}
+			InsertString(pos);
 		}
 	}
-	while(len > 0);
+
 	EncodeEnd();
 	_code = m_dest;
 	_codesize = m_dest_pos;
 }
 
-void _lzhuf::Decode(uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize)
+uint32_t xr_lzhuf_context::DecodedSize(const uint8_t *_code, uint32_t _codesize)
 {
-	m_dest_limit = textsize = *(uint32_t*)_code;
-	m_dest = static_cast<uint8_t*>(malloc(m_dest_limit));
-	m_dest_pos = 0;
+	// the unpacked size is stored in front of the stream, so the output never has to grow
+	return _codesize >= 4 ? *(const uint32_t*)_code : 0;
+}
+
+void xr_lzhuf_context::Decode(uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize)
+{
+	uint32_t textsize = DecodedSize(_code, _codesize);
+	auto text = static_cast<uint8_t*>(malloc(std::max<uint32_t>(textsize, 1)));
+
+	DecodeTo(text, textsize, _code, _codesize);
+
+	_text = text;
+	_textsize = textsize;
+}
+
+void xr_lzhuf_context::DecodeTo(uint8_t *text, uint32_t textsize, const uint8_t *_code, uint32_t _codesize)
+{
+	xr_metrics::scoped_timer timer(xr_metrics::LZHUF_DECODE, textsize);
 
-	m_src_limit = codesize = _codesize;
+	m_src_limit = _codesize;
 	m_src = _code;
 	m_src_pos = 4;
 
-	getbuf = 0;
-	getlen = 0;
+	m_bits = 0;
+	m_bit_count = 0;
 
 	StartHuff();
-	for(int i = 0; i < N - F; i++)
-	{
-		text_buf[i] = ' ';
-	}
 
-	auto r = N - F;
-	for(uint32_t count = 0; count < textsize;)
+	for(uint32_t pos = 0; pos < textsize;)
 	{
 		auto c = DecodeChar();
 		if(c < 256)
 		{
-			putc(c);
-			text_buf[r++] = static_cast<unsigned char>(c);
-			r &= (N - 1);
-			count++;
+			text[pos++] = static_cast<uint8_t>(c);
+			continue;
+		}
+
+		uint32_t distance = DecodePosition() + 1;
+		auto length = std::min<uint32_t>(c - 255 + THRESHOLD, textsize - pos);
+		auto dest = text + pos;
+
+		if(distance > pos)
+		{
+			// reaches into the N - F spaces the dictionary starts with
+			for(uint32_t k = 0; k < length; k++)
+			{
+				dest[k] = pos + k < distance ? ' ' : text[pos + k - distance];
+			}
+		}
+		else if(distance >= length)
+		{
+			std::memcpy(dest, dest - distance, length);
 		}
 		else
 		{
-			auto i = (r - DecodePosition() - 1) & (N - 1);
-			auto j = c - 255 + THRESHOLD;
-
-			for(int k = 0; k < j; k++)
+			// overlapping match repeats the last distance bytes
+			auto src = dest - distance;
+			for(uint32_t k = 0; k < length; k++)
 			{
-				c = text_buf[(i + k) & (N - 1)];
-				putc(c);
-				text_buf[r++] = static_cast<unsigned char>(c);
-				r &= (N - 1);
-				count++;
+				dest[k] = src[k];
 			}
 		}
-	}
-	assert(m_dest_pos == textsize);
-	_text = m_dest;
-	_textsize = textsize;
-}
 
-int _lzhuf::getc()
-{
-	return m_src_pos < m_src_limit ? m_src[m_src_pos++] : -1;
+		pos += length;
+	}
 }
 
-void _lzhuf::putc(int c)
+void xr_lzhuf_context::putc(int c)
 {
 	if(m_dest_pos >= m_dest_limit)
 	{
@@ -673,8 +553,14 @@ void _lzhuf::putc(int c)
 	m_dest[m_dest_pos++] = static_cast<unsigned char>(c);
 }
 
-xr_lzhuf* xr_lzhuf::instance()
+xr_lzhuf_context& xr_lzhuf::context()
 {
-	static xr_lzhuf instance;
-	return &instance;
+	// allocated on first use, so threads that never touch LZHUF don't pay for it
+	thread_local std::unique_ptr<xr_lzhuf_context> context;
+	if(!context)
+	{
+		context = std::make_unique<xr_lzhuf_context>();
+	}
+
+	return *context;
 }
@@ -3,10 +3,14 @@
 #include "xr_types.hxx"
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 namespace xray_re
 {
-	class _lzhuf
+	// Complete LZHUF coder state: sliding dictionary, match trees and adaptive huffman tree.
+	// A context is not thread-safe by itself, but separate contexts can be used in parallel.
+	class xr_lzhuf_context
 	{
 	private:
 		enum basic_params
@@ -19,20 +23,30 @@ namespace xray_re
 
 		enum derived_params
 		{
-			NIL = N,
 			N_CHAR = 256 - THRESHOLD + F,
 			T = N_CHAR * 2 - 1,
 			R = T - 1,
 		};
 
-		unsigned char text_buf[N + F - 1];
-		int match_position, lson[N + 1], rson[N + 257], dad[N + 1];
-		uint32_t match_length;
+		// encoder match finder: hash chains over the last WINDOW bytes
+		enum match_params
+		{
+			WINDOW = N - F,
+			HASH_BITS = 14,
+			HASH_SIZE = 1 << HASH_BITS,
+			MAX_CHAIN = 256,
+		};
+
+		static constexpr uint32_t NO_POS = UINT32_MAX;
+
 		unsigned int freq[T + 1];
 		int prnt[T + N_CHAR];
 		int son[T];
 
-		uint32_t textsize;
+		std::vector<uint8_t> m_window;
+		uint32_t m_head[HASH_SIZE];
+		uint32_t m_prev[N];
+
 		uint8_t *m_dest;
 		uint32_t m_dest_pos;
 		uint32_t m_dest_limit;
@@ -42,8 +56,8 @@ namespace xray_re
 		uint32_t m_src_pos;
 		uint32_t m_src_limit;
 
-		unsigned int getbuf;
-		unsigned char getlen;
+		uint64_t m_bits;       // decoder bit buffer, next bit is the most significant one
+		uint32_t m_bit_count;
 
 		unsigned int putbuf;
 		unsigned char putlen;
@@ -53,12 +67,12 @@ namespace xray_re
 		static const std::array<uint8_t, 256> d_code;
 		static const std::array<uint8_t, 256> d_len;
 
-		void InitTree();
-		void InsertNode(int r);
-		void DeleteNode(int p);
+		uint32_t Hash(uint32_t pos) const;
+		void InsertString(uint32_t pos);
+		uint32_t FindMatch(uint32_t pos, uint32_t& distance) const;
 
-		int GetBit();
-		int GetByte(void);
+		void FillBits();
+		void DropBits(uint32_t count);
 		void Putcode(int l, unsigned int c);
 
 		void StartHuff();
@@ -70,37 +84,64 @@ namespace xray_re
 		int DecodeChar();
 		int DecodePosition();
 
-		int getc();
 		void putc(int c);
 
 	public:
 		void Encode(uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize);
 		void Decode(uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize);
+		// _text must hold DecodedSize() bytes
+		void DecodeTo(uint8_t *_text, uint32_t _textsize, const uint8_t *_code, uint32_t _codesize);
+
+		static uint32_t DecodedSize(const uint8_t *_code, uint32_t _codesize);
 	};
 
 	class xr_lzhuf
 	{
 	private:
-		_lzhuf m_lzhuf;
-		static xr_lzhuf* instance();
-
-	protected:
-		xr_lzhuf() = default;
-		xr_lzhuf(const xr_lzhuf& that);
-		xr_lzhuf& operator=(const xr_lzhuf& right);
+		static xr_lzhuf_context& context();
 
 	public:
+		xr_lzhuf() = delete;
+
+		// use the context owned by the calling thread
 		static void compress(uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize);
 		static void decompress(uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize);
+
+		static void compress(xr_lzhuf_context& context, uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize);
+		static void decompress(xr_lzhuf_context& context, uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize);
+
+		// unpacks into a caller owned buffer of at least decompressed_size() bytes
+		static uint32_t decompressed_size(const uint8_t *_code, uint32_t _codesize);
+		static void decompress_into(uint8_t *_text, uint32_t _textsize, const uint8_t *_code, uint32_t _codesize);
 	};
 
 	inline void xr_lzhuf::compress(uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize)
 	{
-		instance()->m_lzhuf.Encode(_code, _codesize, _text, _textsize);
+		context().Encode(_code, _codesize, _text, _textsize);
 	}
 
 	inline void xr_lzhuf::decompress(uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize)
 	{
-		instance()->m_lzhuf.Decode(_text, _textsize, _code, _codesize);
+		context().Decode(_text, _textsize, _code, _codesize);
+	}
+
+	inline void xr_lzhuf::compress(xr_lzhuf_context& context, uint8_t *&_code, uint32_t& _codesize, const uint8_t *_text, uint32_t _textsize)
+	{
+		context.Encode(_code, _codesize, _text, _textsize);
+	}
+
+	inline void xr_lzhuf::decompress(xr_lzhuf_context& context, uint8_t *&_text, uint32_t& _textsize, const uint8_t *_code, uint32_t _codesize)
+	{
+		context.Decode(_text, _textsize, _code, _codesize);
+	}
+
+	inline uint32_t xr_lzhuf::decompressed_size(const uint8_t *_code, uint32_t _codesize)
+	{
+		return xr_lzhuf_context::DecodedSize(_code, _codesize);
+	}
+
+	inline void xr_lzhuf::decompress_into(uint8_t *_text, uint32_t _textsize, const uint8_t *_code, uint32_t _codesize)
+	{
+		context().DecodeTo(_text, _textsize, _code, _codesize);
 	}
 } // namespace xray_re
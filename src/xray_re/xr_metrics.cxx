@@ -0,0 +1,129 @@
+#include "xr_metrics.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+using namespace xray_re;
+
+namespace
+{
+	// every stage on its own cache line, workers hitting different stages don't contend
+	struct alignas(64) counters
+	{
+		std::atomic<uint64_t> calls{0};
+		std::atomic<uint64_t> bytes{0};
+		std::atomic<uint64_t> nanoseconds{0};
+	};
+
+	counters s_counters[xr_metrics::STAGE_COUNT];
+
+	const char *s_names[xr_metrics::STAGE_COUNT] =
+	{
+		"descramble",
+		"scramble",
+		"lzhuf_decode",
+		"lzhuf_encode",
+		"lzo_decode",
+		"lzo_encode",
+		"crc",
+		"file_read",
+		"create_folder",
+		"file_open",
+		"file_write",
+		"file_close",
+		"uring_wait"
+	};
+
+	double MebibytesPerSecond(const xr_metrics::totals& t)
+	{
+		return t.nanoseconds == 0 ? 0.0 : (t.bytes / (1024.0 * 1024.0)) / (t.nanoseconds / 1e9);
+	}
+}
+
+bool xr_metrics::s_enabled = false;
+
+void xr_metrics::set_enabled(bool value)
+{
+	s_enabled = value;
+}
+
+void xr_metrics::add(stage s, uint64_t nanoseconds, uint64_t bytes)
+{
+	auto& c = s_counters[s];
+	c.calls.fetch_add(1, std::memory_order_relaxed);
+	c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	c.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+xr_metrics::totals xr_metrics::get(stage s)
+{
+	const auto& c = s_counters[s];
+	return totals{c.calls.load(std::memory_order_relaxed), c.bytes.load(std::memory_order_relaxed), c.nanoseconds.load(std::memory_order_relaxed)};
+}
+
+void xr_metrics::reset()
+{
+	for(auto& c : s_counters)
+	{
+		c.calls = 0;
+		c.bytes = 0;
+		c.nanoseconds = 0;
+	}
+}
+
+const char* xr_metrics::name(stage s)
+{
+	return s < STAGE_COUNT ? s_names[s] : "unknown";
+}
+
+void xr_metrics::log_summary(const std::string& operation, double wall_seconds)
+{
+	spdlog::info("Stages of {} ({:.3f}s wall time, stage times are summed over threads):", operation, wall_seconds);
+
+	for(int i = 0; i < STAGE_COUNT; i++)
+	{
+		auto s = static_cast<stage>(i);
+		auto t = get(s);
+		if(t.calls == 0)
+		{
+			continue;
+		}
+
+		auto seconds = t.nanoseconds / 1e9;
+		spdlog::info("  {:<14} {:>10} calls {:>12.1f} MiB {:>10.3f}s {:>6.1f}% {:>10.1f} MiB/s", name(s), t.calls,
+			t.bytes / (1024.0 * 1024.0), seconds, wall_seconds > 0 ? 100.0 * seconds / wall_seconds : 0.0, MebibytesPerSecond(t));
+	}
+}
+
+bool xr_metrics::save_json(const std::string& path, const std::string& operation, double wall_seconds)
+{
+	auto file = std::fopen(path.c_str(), "w");
+	if(!file)
+	{
+		spdlog::error("Failed to open {}: {} (errno={}) ", path, strerror(errno), errno);
+		return false;
+	}
+
+	// all the stages are always listed, so consumers can rely on the schema
+	fmt::print(file, "{{\n  \"operation\": \"{}\",\n  \"wall_seconds\": {:.6f},\n  \"stages\": {{", operation, wall_seconds);
+	for(int i = 0; i < STAGE_COUNT; i++)
+	{
+		auto s = static_cast<stage>(i);
+		auto t = get(s);
+		fmt::print(file, "{}\n    \"{}\": {{\"calls\": {}, \"bytes\": {}, \"seconds\": {:.6f}, \"mib_per_second\": {:.3f}}}",
+			i == 0 ? "" : ",", name(s), t.calls, t.bytes, t.nanoseconds / 1e9, MebibytesPerSecond(t));
+	}
+	fmt::print(file, "\n  }}\n}}\n");
+
+	if(std::fclose(file) != 0)
+	{
+		spdlog::error("Failed to write {}", path);
+		return false;
+	}
+
+	return true;
+}
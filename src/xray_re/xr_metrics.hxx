@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace xray_re
+{
+	// Process wide time, call and byte counters of the pack/unpack stages. Collection is off by
+	// default, a disabled timer costs a single branch. Times are summed over all the threads,
+	// so with several jobs a stage may take longer than the whole run.
+	class xr_metrics
+	{
+	public:
+		enum stage
+		{
+			DESCRAMBLE,
+			SCRAMBLE,
+			LZHUF_DECODE,
+			LZHUF_ENCODE,
+			LZO_DECODE,
+			LZO_ENCODE,
+			CRC,
+			FILE_READ,
+			CREATE_FOLDER,
+			FILE_OPEN,
+			FILE_WRITE,
+			FILE_CLOSE,
+			URING_WAIT,
+			STAGE_COUNT
+		};
+
+		struct totals
+		{
+			uint64_t calls{0};
+			uint64_t bytes{0};
+			uint64_t nanoseconds{0};
+		};
+
+		class scoped_timer
+		{
+		public:
+			explicit scoped_timer(stage s, uint64_t bytes = 0);
+			~scoped_timer();
+
+			scoped_timer(const scoped_timer&) = delete;
+			scoped_timer& operator=(const scoped_timer&) = delete;
+
+			// for stages that learn the amount of data only when they are done
+			void set_bytes(uint64_t bytes);
+
+		private:
+			stage m_stage;
+			uint64_t m_bytes;
+			bool m_enabled;
+			std::chrono::steady_clock::time_point m_start;
+		};
+
+		xr_metrics() = delete;
+
+		static void set_enabled(bool value);
+		static bool is_enabled();
+
+		static void add(stage s, uint64_t nanoseconds, uint64_t bytes);
+		static totals get(stage s);
+		static void reset();
+
+		static const char* name(stage s);
+
+		// wall_seconds is the duration of the whole operation, stages are reported relative to it
+		static void log_summary(const std::string& operation, double wall_seconds);
+		static bool save_json(const std::string& path, const std::string& operation, double wall_seconds);
+
+	private:
+		static bool s_enabled;
+	};
+
+	inline xr_metrics::scoped_timer::scoped_timer(stage s, uint64_t bytes) : m_stage(s), m_bytes(bytes), m_enabled(s_enabled)
+	{
+		if(m_enabled)
+		{
+			m_start = std::chrono::steady_clock::now();
+		}
+	}
+
+	inline xr_metrics::scoped_timer::~scoped_timer()
+	{
+		if(m_enabled)
+		{
+			auto elapsed = std::chrono::steady_clock::now() - m_start;
+			add(m_stage, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), m_bytes);
+		}
+	}
+
+	inline void xr_metrics::scoped_timer::set_bytes(uint64_t bytes) { m_bytes = bytes; }
+
+	inline bool xr_metrics::is_enabled() { return s_enabled; }
+} // namespace xray_re
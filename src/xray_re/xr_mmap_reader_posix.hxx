@@ -12,9 +12,13 @@ namespace xray_re
 		xr_mmap_reader_posix(const std::string& path);
 		~xr_mmap_reader_posix() override;
 
+		int fd() const;
+
 	private:
 		int m_fd{-1};
 		std::size_t m_file_length{0};
 		std::size_t m_mem_length{0};
 	};
+
+	inline int xr_mmap_reader_posix::fd() const { return m_fd; }
 } // namespace xray_re
@@ -7,6 +7,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <vector>
+
 using namespace xray_re;
 
 xr_reader* xr_reader::open_chunk(uint32_t id, const xr_scrambler& scrambler)
@@ -23,11 +25,12 @@ xr_reader* xr_reader::open_chunk(uint32_t id, const xr_scrambler& scrambler)
 
 	if(compressed)
 	{
-		uint8_t temp[size];
-		scrambler.decrypt(temp, m_p, size);
+		// headers of big archives don't fit on the stack
+		std::vector<uint8_t> temp(size);
+		scrambler.decrypt(temp.data(), m_p, size);
 		uint8_t *data;
 		uint32_t real_size;
-		xr_lzhuf::decompress(data, real_size, temp, size);
+		xr_lzhuf::decompress(data, real_size, temp.data(), size);
 		return new xr_temp_reader(data, real_size);
 	}
 	else
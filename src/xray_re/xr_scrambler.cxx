@@ -1,4 +1,5 @@
 #include "xr_scrambler.hxx"
+#include "xr_metrics.hxx"
 
 #include <numeric>
 #include <utility>
@@ -63,6 +64,7 @@ void xr_scrambler::init_sboxes(int seed, std::size_t size_mult)
 
 void xr_scrambler::decrypt(uint8_t *dest, const uint8_t *src, std::size_t size) const
 {
+	xr_metrics::scoped_timer timer(xr_metrics::DESCRAMBLE, size);
 	auto seed = m_seed;
 	for(std::size_t i = 0; i != size; ++i)
 	{
@@ -73,6 +75,7 @@ void xr_scrambler::decrypt(uint8_t *dest, const uint8_t *src, std::size_t size)
 
 void xr_scrambler::encrypt(uint8_t *dest, const uint8_t *src, std::size_t size) const
 {
+	xr_metrics::scoped_timer timer(xr_metrics::SCRAMBLE, size);
 	auto seed = m_seed;
 	for(std::size_t i = 0; i != size; ++i)
 	{
@@ -28,14 +28,10 @@ namespace xray_re
 		DB_VERSION_XDB    = 0x20
 	};
 
-	struct db_file
+	enum class CompressionLevel
 	{
-		bool operator<(const db_file& file) const;
-
-		std::string path;
-		std::size_t offset;
-		std::size_t size_real;
-		std::size_t size_compressed;
-		unsigned int crc;
+		NONE = 0,
+		FAST = 1, // LZO1X-1
+		MAX  = 2  // LZO1X-999
 	};
 } // namespace xray_re
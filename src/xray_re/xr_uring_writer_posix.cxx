@@ -0,0 +1,501 @@
+#include "xr_uring_writer_posix.hxx"
+#include "xr_metrics.hxx"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define XR_HAVE_IO_URING 1
+#endif
+
+using namespace xray_re;
+
+struct xr_uring_writer_posix::request
+{
+	enum
+	{
+		STAGE_OPEN,
+		STAGE_WRITE,
+		STAGE_CLOSE
+	} stage{STAGE_OPEN};
+
+	int dirfd{AT_FDCWD};
+	std::string path;
+	const uint8_t *data{nullptr};
+	std::size_t size{0};
+	std::size_t written{0};
+	completion on_complete;
+	int fd{-1};
+	int error{0};
+};
+
+#ifdef XR_HAVE_IO_URING
+
+// single write request is limited by 32-bit length
+constexpr std::size_t MAX_WRITE_SIZE = 1u << 30;
+
+static int io_uring_setup(unsigned int entries, io_uring_params *params)
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+static int io_uring_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args)
+{
+	return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+struct xr_uring_writer_posix::ring
+{
+	explicit ring(unsigned int entries)
+	{
+		io_uring_params params{};
+		fd = io_uring_setup(entries, &params);
+		if(fd == -1)
+		{
+			throw std::runtime_error(fmt::format("io_uring_setup failed: {} (errno={}) ", strerror(errno), errno));
+		}
+
+		sq_length = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		cq_length = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		sqes_length = params.sq_entries * sizeof(io_uring_sqe);
+
+		bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if(single_mmap)
+		{
+			sq_length = cq_length = std::max(sq_length, cq_length);
+		}
+
+		sq_ptr = mmap(nullptr, sq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		cq_ptr = single_mmap ? sq_ptr : mmap(nullptr, cq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+		if(sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+		{
+			auto error = errno;
+			release();
+			throw std::runtime_error(fmt::format("mmap failed for io_uring: {} (errno={}) ", strerror(error), error));
+		}
+
+		auto sq = static_cast<uint8_t*>(sq_ptr);
+		sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+		sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+		sq_mask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+		sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+		sq_local_tail = *sq_tail;
+
+		auto cq = static_cast<uint8_t*>(cq_ptr);
+		cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+		cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+		cq_mask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+	}
+
+	~ring()
+	{
+		release();
+	}
+
+	void release()
+	{
+		if(sqes && sqes != MAP_FAILED)
+		{
+			munmap(sqes, sqes_length);
+		}
+
+		if(cq_ptr && cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+		{
+			munmap(cq_ptr, cq_length);
+		}
+
+		if(sq_ptr && sq_ptr != MAP_FAILED)
+		{
+			munmap(sq_ptr, sq_length);
+		}
+
+		if(fd != -1)
+		{
+			::close(fd);
+		}
+
+		sqes = nullptr;
+		sq_ptr = cq_ptr = nullptr;
+		fd = -1;
+	}
+
+	// the caller keeps the number of in-flight requests below the queue size, so there is always room
+	io_uring_sqe* next_sqe()
+	{
+		auto index = sq_local_tail++ & sq_mask;
+		auto sqe = &sqes[index];
+		std::memset(sqe, 0, sizeof(io_uring_sqe));
+		sq_array[index] = index;
+		return sqe;
+	}
+
+	// publishes prepared entries, returns the number of entries the kernel hasn't consumed yet
+	unsigned int flush()
+	{
+		__atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+		return sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+	}
+
+	int fd{-1};
+
+	void *sq_ptr{nullptr};
+	std::size_t sq_length{0};
+	unsigned int *sq_head{nullptr};
+	unsigned int *sq_tail{nullptr};
+	unsigned int sq_local_tail{0};
+	unsigned int sq_mask{0};
+	unsigned int *sq_array{nullptr};
+
+	void *cq_ptr{nullptr};
+	std::size_t cq_length{0};
+	unsigned int *cq_head{nullptr};
+	unsigned int *cq_tail{nullptr};
+	unsigned int cq_mask{0};
+	io_uring_cqe *cqes{nullptr};
+
+	io_uring_sqe *sqes{nullptr};
+	std::size_t sqes_length{0};
+};
+
+xr_uring_writer_posix::xr_uring_writer_posix(unsigned int queue_depth) :
+	m_ring(std::make_unique<ring>(queue_depth)), m_queue_depth(queue_depth) {}
+
+xr_uring_writer_posix::~xr_uring_writer_posix()
+{
+	try
+	{
+		wait();
+	}
+	catch(const std::exception& e)
+	{
+		spdlog::error("Exception: {}", e.what());
+	}
+}
+
+bool xr_uring_writer_posix::is_supported()
+{
+	static const bool supported = []()
+	{
+		io_uring_params params{};
+		auto fd = io_uring_setup(1, &params);
+		if(fd == -1)
+		{
+			spdlog::debug("io_uring_setup failed: {} (errno={}) ", strerror(errno), errno);
+			return false;
+		}
+
+		const std::size_t ops_count = 256;
+		std::vector<uint8_t> memory(sizeof(io_uring_probe) + ops_count * sizeof(io_uring_probe_op));
+		auto probe = reinterpret_cast<io_uring_probe*>(memory.data());
+
+		bool result = io_uring_register(fd, IORING_REGISTER_PROBE, probe, ops_count) == 0;
+		if(result)
+		{
+			for(auto op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE})
+			{
+				result = result && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+			}
+		}
+
+		::close(fd);
+		return result;
+	}();
+
+	return supported;
+}
+
+void xr_uring_writer_posix::write_file(const std::string& path, const void *data, std::size_t size, completion on_complete)
+{
+	write_file(AT_FDCWD, path, data, size, std::move(on_complete));
+}
+
+void xr_uring_writer_posix::write_file(int dirfd, const std::string& path, const void *data, std::size_t size, completion on_complete)
+{
+	while(m_in_flight >= m_queue_depth)
+	{
+		// the ring failing here takes this file down with the ones in flight
+		try
+		{
+			reap(1);
+		}
+		catch(const std::system_error& e)
+		{
+			if(on_complete)
+			{
+				on_complete(e.code().value());
+			}
+			throw;
+		}
+	}
+
+	auto r = new request;
+	r->dirfd = dirfd;
+	r->path = path;
+	r->data = static_cast<const uint8_t*>(data);
+	r->size = size;
+	r->on_complete = std::move(on_complete);
+
+	m_requests.push_back(r);
+	m_in_flight++;
+	push(r);
+}
+
+void xr_uring_writer_posix::wait()
+{
+	while(m_in_flight != 0)
+	{
+		reap(1);
+	}
+}
+
+void xr_uring_writer_posix::push(request *r)
+{
+	auto sqe = m_ring->next_sqe();
+	sqe->user_data = reinterpret_cast<uint64_t>(r);
+
+	switch(r->stage)
+	{
+		case request::STAGE_OPEN:
+		{
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = r->dirfd;
+			sqe->addr = reinterpret_cast<uint64_t>(r->path.c_str());
+			sqe->len = 0666;
+			sqe->open_flags = O_RDWR | O_CREAT;
+			break;
+		}
+		case request::STAGE_WRITE:
+		{
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->fd = r->fd;
+			sqe->addr = reinterpret_cast<uint64_t>(r->data + r->written);
+			sqe->len = static_cast<uint32_t>(std::min(r->size - r->written, MAX_WRITE_SIZE));
+			sqe->off = r->written;
+			break;
+		}
+		case request::STAGE_CLOSE:
+		{
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = r->fd;
+			break;
+		}
+	}
+}
+
+void xr_uring_writer_posix::reap(unsigned int min_complete)
+{
+	auto& ring = *m_ring;
+
+	// the kernel does the writes, so the time the caller spends blocked here stands for them
+	xr_metrics::scoped_timer timer(xr_metrics::URING_WAIT);
+
+	int res;
+	do
+	{
+		res = io_uring_enter(ring.fd, ring.flush(), min_complete, IORING_ENTER_GETEVENTS);
+	}
+	while(res == -1 && errno == EINTR);
+
+	if(res == -1)
+	{
+		auto error = errno;
+		cancel(error);
+		throw std::system_error(error, std::generic_category(), "io_uring_enter failed");
+	}
+
+	auto head = *ring.cq_head;
+	auto tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+	uint64_t written = 0;
+
+	// completions may queue follow-up requests, they get submitted on the next call
+	while(head != tail)
+	{
+		const auto& cqe = ring.cqes[head & ring.cq_mask];
+		auto r = reinterpret_cast<request*>(cqe.user_data);
+		auto cqe_res = cqe.res;
+		head++;
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+		if(r->stage == request::STAGE_WRITE && cqe_res > 0)
+		{
+			written += static_cast<uint64_t>(cqe_res);
+		}
+
+		complete(r, cqe_res);
+	}
+
+	timer.set_bytes(written);
+}
+
+void xr_uring_writer_posix::complete(request *r, int res)
+{
+	switch(r->stage)
+	{
+		case request::STAGE_OPEN:
+		{
+			if(res < 0)
+			{
+				r->error = -res;
+				finish(r);
+				return;
+			}
+
+			r->fd = res;
+			r->stage = r->size != 0 ? request::STAGE_WRITE : request::STAGE_CLOSE;
+			break;
+		}
+		case request::STAGE_WRITE:
+		{
+			if(res == -EINTR || res == -EAGAIN)
+			{
+				break;
+			}
+
+			if(res <= 0)
+			{
+				r->error = res < 0 ? -res : EIO;
+				r->stage = request::STAGE_CLOSE;
+				break;
+			}
+
+			r->written += static_cast<std::size_t>(res);
+			if(r->written == r->size)
+			{
+				r->stage = request::STAGE_CLOSE;
+			}
+			break;
+		}
+		case request::STAGE_CLOSE:
+		{
+			if(res < 0 && r->error == 0)
+			{
+				r->error = -res;
+			}
+
+			finish(r);
+			return;
+		}
+	}
+
+	push(r);
+}
+
+void xr_uring_writer_posix::cancel(int error)
+{
+	auto& ring = *m_ring;
+
+	// the kernel only reads the submission queue inside io_uring_enter, entries it hasn't taken can be withdrawn
+	auto queued = ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+	ring.sq_local_tail -= queued;
+	__atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+
+	// the rest may still read file data, so wait for it unless the ring is broken for good
+	auto in_kernel = m_in_flight - queued;
+	while(in_kernel != 0)
+	{
+		if(io_uring_enter(ring.fd, 0, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR)
+		{
+			spdlog::error("Abandoning {} io_uring requests: {} (errno={}) ", in_kernel, strerror(errno), errno);
+			break;
+		}
+
+		auto head = *ring.cq_head;
+		auto tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for(; head != tail; head++, in_kernel--)
+		{
+			const auto& cqe = ring.cqes[head & ring.cq_mask];
+			auto r = reinterpret_cast<request*>(cqe.user_data);
+
+			if(r->stage == request::STAGE_OPEN && cqe.res >= 0)
+			{
+				r->fd = cqe.res;
+			}
+			else if(r->stage == request::STAGE_CLOSE)
+			{
+				// this file made it, nothing is left to do for it
+				if(cqe.res < 0 && r->error == 0)
+				{
+					r->error = -cqe.res;
+				}
+				r->fd = -1;
+				finish(r);
+			}
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	// files that didn't get through are closed here and fail with the error of the ring
+	while(!m_requests.empty())
+	{
+		auto r = m_requests.back();
+		if(r->fd != -1)
+		{
+			::close(r->fd);
+		}
+
+		if(r->error == 0)
+		{
+			r->error = error;
+		}
+		finish(r);
+	}
+}
+
+#else
+
+struct xr_uring_writer_posix::ring {};
+
+xr_uring_writer_posix::xr_uring_writer_posix(unsigned int queue_depth) : m_queue_depth(queue_depth)
+{
+	throw std::runtime_error("io_uring is not supported by this build");
+}
+
+xr_uring_writer_posix::~xr_uring_writer_posix() = default;
+
+bool xr_uring_writer_posix::is_supported()
+{
+	return false;
+}
+
+void xr_uring_writer_posix::write_file(const std::string&, const void*, std::size_t, completion) {}
+void xr_uring_writer_posix::write_file(int, const std::string&, const void*, std::size_t, completion) {}
+void xr_uring_writer_posix::wait() {}
+void xr_uring_writer_posix::push(request*) {}
+void xr_uring_writer_posix::reap(unsigned int) {}
+void xr_uring_writer_posix::complete(request*, int) {}
+void xr_uring_writer_posix::cancel(int) {}
+
+#endif
+
+void xr_uring_writer_posix::finish(request *r)
+{
+	auto it = std::find(m_requests.begin(), m_requests.end(), r);
+	*it = m_requests.back();
+	m_requests.pop_back();
+
+	m_in_flight--;
+	if(r->on_complete)
+	{
+		r->on_complete(r->error);
+	}
+	delete r;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "xr_types.hxx"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xray_re
+{
+	// Writes whole files through io_uring. Open, write and close requests of many
+	// files are kept in flight at once instead of being issued one after another.
+	class xr_uring_writer_posix
+	{
+	public:
+		enum
+		{
+			DEFAULT_QUEUE_DEPTH = 64
+		};
+
+		// error is 0 on success or errno value
+		using completion = std::function<void(int error)>;
+
+		explicit xr_uring_writer_posix(unsigned int queue_depth = DEFAULT_QUEUE_DEPTH);
+		~xr_uring_writer_posix();
+
+		xr_uring_writer_posix(const xr_uring_writer_posix&) = delete;
+		xr_uring_writer_posix& operator=(const xr_uring_writer_posix&) = delete;
+
+		// false if the kernel (or the build) has no io_uring with openat/write/close
+		static bool is_supported();
+
+		// data must stay valid until on_complete is called. If the ring fails, every file handed over
+		// so far (this one included) is closed and completed with the error before std::system_error is thrown.
+		void write_file(const std::string& path, const void *data, std::size_t size, completion on_complete);
+		// path is opened relative to dirfd, which must stay open until on_complete is called
+		void write_file(int dirfd, const std::string& path, const void *data, std::size_t size, completion on_complete);
+		void wait();
+
+	private:
+		struct ring;
+		struct request;
+
+		void push(request *r);
+		void reap(unsigned int min_complete);
+		void complete(request *r, int res);
+		void finish(request *r);
+		// finishes every request in flight after the ring failed
+		void cancel(int error);
+
+		std::unique_ptr<ring> m_ring;
+		unsigned int m_queue_depth;
+		unsigned int m_in_flight{0};
+		// requests between write_file and their completion, in no particular order
+		std::vector<request*> m_requests;
+	};
+} // namespace xray_re
@@ -8,9 +8,59 @@
 #include <string>
 #include <cstring>
 #include <cstdarg>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
 
 using namespace xray_re;
 
+std::size_t xr_writer::w_file_range(int, std::size_t, std::size_t)
+{
+	return 0;
+}
+
+bool xr_writer::sync()
+{
+	return true;
+}
+
+bool xr_writer::w_file(int fd, std::size_t size)
+{
+	auto copied = w_file_range(fd, 0, size);
+	if(copied == size)
+	{
+		return true;
+	}
+
+	// the kernel couldn't copy (or the writer doesn't support it), read the rest
+	constexpr std::size_t BUFFER_SIZE = 256 * 1024;
+	std::vector<uint8_t> buffer(std::min(BUFFER_SIZE, size - copied));
+
+	for(auto pos = copied; pos < size;)
+	{
+		auto res = ::pread(fd, buffer.data(), std::min(buffer.size(), size - pos), static_cast<off_t>(pos));
+		if(res == -1 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(res <= 0)
+		{
+			// EOF leaves errno untouched, make sure callers don't report a stale one
+			if(res == 0)
+			{
+				errno = ENODATA;
+			}
+			return false;
+		}
+
+		w_raw(buffer.data(), static_cast<std::size_t>(res));
+		pos += static_cast<std::size_t>(res);
+	}
+
+	return true;
+}
+
 void xr_writer::open_chunk(uint32_t id)
 {
 	spdlog::debug("xr_writer::open_chunk chunk_id={} compressed={}", id & ~CHUNK_COMPRESSED, (id & CHUNK_COMPRESSED) != 0);
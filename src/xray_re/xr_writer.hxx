@@ -19,6 +19,18 @@ namespace xray_re
 		virtual void seek(std::size_t pos) = 0;
 		virtual std::size_t tell() = 0;
 
+		// Copies size bytes at offset of file descriptor fd without passing them through
+		// user space, returns the number of bytes copied (0 if the writer can't do that).
+		virtual std::size_t w_file_range(int fd, std::size_t offset, std::size_t size);
+
+		// Appends the first size bytes of fd, through w_file_range() when the writer supports it.
+		// Returns false if the file turns out to be shorter or can't be read, the bytes that were
+		// read are written anyway, so the caller has to discard the output.
+		bool w_file(int fd, std::size_t size);
+
+		// Pushes out anything the writer holds back, returns false if any write so far has failed.
+		virtual bool sync();
+
 		void open_chunk(uint32_t id);
 		void close_chunk();
 		void w_raw_chunk(uint32_t id, const void *data, std::size_t size);
@@ -0,0 +1,57 @@
+#include "archive_generator.hxx"
+#include "db_tools.hxx"
+#include "temp_dir_test.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+class ArchiveGeneratorTest : public TempDirTest<testing::TestWithParam<std::pair<xray_re::DBVersion, bool>>>
+{
+protected:
+	ArchiveGeneratorTest() : TempDirTest("gtest_archive_generator") {}
+};
+
+TEST_P(ArchiveGeneratorTest, UnpacksToGeneratedFiles)
+{
+	ArchiveSpec spec;
+	spec.version = GetParam().first;
+	spec.compress = GetParam().second;
+	spec.entries = 50;
+	spec.min_size = 1;
+	spec.max_size = 16 * 1024;
+	spec.depth = 2;
+	spec.fanout = 3;
+
+	ArchiveGenerator generator(spec);
+	ASSERT_TRUE(generator.write(m_root + "archive.db"));
+
+	DBTools::unpack(m_root + "archive.db", m_root + "out", spec.version, "", false, 1);
+
+	for(std::size_t i = 0; i < spec.entries; i++)
+	{
+		auto path = generator.entry_path(i);
+		EXPECT_EQ(read(m_root + "out/" + path), generator.entry_data(i)) << path;
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(AllFormats, ArchiveGeneratorTest, testing::Values(
+	std::make_pair(xray_re::DBVersion::DB_VERSION_1114, false),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_1114, true),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_2215, false),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_2215, true),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_2945, true),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_2947RU, true),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_2947WW, true),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_XDB, false),
+	std::make_pair(xray_re::DBVersion::DB_VERSION_XDB, true)));
+
+TEST(ArchiveGenerator, ReportsFailedWrites)
+{
+	ArchiveSpec spec;
+	spec.entries = 20;
+
+	// opens fine, every write fails with ENOSPC
+	ArchiveGenerator generator(spec);
+	EXPECT_FALSE(generator.write("/dev/full"));
+}
@@ -0,0 +1,61 @@
+#include "crc32/crc32.hxx"
+
+#include <gtest/gtest.h>
+#include <boost/crc.hpp>
+
+#include <random>
+#include <vector>
+
+unsigned int ReferenceChecksum(const uint8_t *data, std::size_t size)
+{
+	boost::crc_32_type result;
+	result.process_bytes(data, size);
+	return result.checksum();
+}
+
+std::vector<uint8_t> RandomData(std::size_t size)
+{
+	std::mt19937 generator(static_cast<unsigned int>(size));
+	std::uniform_int_distribution<int> distribution(0, 255);
+
+	std::vector<uint8_t> data(size);
+	for(auto& byte : data)
+	{
+		byte = static_cast<uint8_t>(distribution(generator));
+	}
+
+	return data;
+}
+
+TEST(CRC32, KnownValues)
+{
+	EXPECT_EQ(crc32("", 0), 0u);
+	EXPECT_EQ(crc32("123456789", 9), 0xcbf43926u);
+}
+
+TEST(CRC32, MatchesReferenceForAllSizesAndAlignments)
+{
+	auto data = RandomData(4096 + 16);
+
+	for(std::size_t size = 0; size <= 1024; size++)
+	{
+		for(std::size_t offset = 0; offset < 16; offset += 5)
+		{
+			ASSERT_EQ(crc32(data.data() + offset, size), ReferenceChecksum(data.data() + offset, size)) << "size=" << size << " offset=" << offset;
+		}
+	}
+
+	ASSERT_EQ(crc32(data.data(), 4096), ReferenceChecksum(data.data(), 4096));
+}
+
+TEST(CRC32, ContinuationMatchesSinglePass)
+{
+	auto data = RandomData(100000);
+
+	for(std::size_t split : {0, 1, 15, 64, 65, 4095, 50000, 99999})
+	{
+		auto crc = crc32(0, data.data(), split);
+		crc = crc32(crc, data.data() + split, data.size() - split);
+		ASSERT_EQ(crc, crc32(data.data(), data.size())) << "split=" << split;
+	}
+}
@@ -0,0 +1,187 @@
+#include "db_archive.hxx"
+#include "db_tools.hxx"
+#include "temp_dir_test.hxx"
+#include "unpacker.hxx"
+#include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_file_writer_posix.hxx"
+#include "xray_re/xr_lzhuf.hxx"
+#include "xray_re/xr_utils.hxx"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class DBArchiveTest : public TempDirTest<>
+{
+protected:
+	DBArchiveTest() : TempDirTest("gtest_db_archive") {}
+
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		fs::create_directories(m_root + "source/config/weapons");
+
+		write("config/system.ltx", std::string(10000, 'a'));
+		write("config/weapons/w_ak74.ltx", "[wpn_ak74]\r\ncost = 5000\r\n");
+		write("empty.txt", "");
+	}
+
+	void write(const std::string& path, const std::string& content)
+	{
+		std::ofstream file(m_root + "source/" + path, std::ios::binary);
+		file << content;
+		m_contents.emplace_back(path, content);
+	}
+
+	std::string pack(xray_re::CompressionLevel compression)
+	{
+		auto archive_path = m_root + "archive.db";
+		DBTools::pack(m_root + "source/", archive_path, xray_re::DBVersion::DB_VERSION_XDB, "", false, 1, compression);
+		return archive_path;
+	}
+
+	std::vector<std::pair<std::string, std::string>> m_contents;
+};
+
+TEST_F(DBArchiveTest, ReadsEveryFile)
+{
+	for(auto compression : {xray_re::CompressionLevel::NONE, xray_re::CompressionLevel::FAST})
+	{
+		DBArchive archive;
+		ASSERT_TRUE(archive.open(pack(compression), xray_re::DBVersion::DB_VERSION_XDB));
+
+		for(const auto& [path, content] : m_contents)
+		{
+			auto entry = archive.lookup(path);
+			ASSERT_NE(entry, DBArchive::npos) << path;
+
+			const auto& entries = archive.entries();
+			ASSERT_EQ(entries.size_real(entry), content.size());
+
+			std::vector<uint8_t> buffer;
+			ASSERT_TRUE(archive.read_into(entry, buffer)) << path;
+			EXPECT_EQ(std::string(buffer.begin(), buffer.end()), content);
+
+			if(auto view = archive.view(entry))
+			{
+				EXPECT_EQ(std::string(reinterpret_cast<const char*>(view), entries.size_real(entry)), content);
+			}
+			else
+			{
+				EXPECT_TRUE(entries.is_compressed(entry));
+			}
+		}
+	}
+}
+
+TEST_F(DBArchiveTest, LookupIgnoresCaseAndSeparators)
+{
+	DBArchive archive;
+	ASSERT_TRUE(archive.open(pack(xray_re::CompressionLevel::NONE), xray_re::DBVersion::DB_VERSION_XDB));
+
+	EXPECT_NE(archive.lookup("CONFIG\\Weapons\\W_AK74.ltx"), DBArchive::npos);
+	EXPECT_EQ(archive.lookup("config/weapons"), DBArchive::npos);
+	EXPECT_EQ(archive.lookup("config/missing.ltx"), DBArchive::npos);
+}
+
+TEST_F(DBArchiveTest, Rejects1114EntryOutOfBounds)
+{
+	// 1114 headers carry no checksum, a damaged size must not send the reader past the archive
+	auto path = m_root + "1114.db";
+	{
+		xray_re::xr_file_writer_posix w(path);
+		w.open_chunk(xray_re::DB_CHUNK_DATA);
+		w.w_raw("0123456789abcdef", 16);
+		w.close_chunk();
+
+		w.open_chunk(xray_re::DB_CHUNK_HEADER);
+		w.w_sz("good.ltx");
+		w.w_u32(1);
+		w.w_u32(8);
+		w.w_u32(16);
+		w.w_sz("bad.ltx");
+		w.w_u32(0);
+		w.w_u32(8);
+		w.w_u32(0xfffffff0);
+		w.close_chunk();
+	}
+
+	auto& file_system = xray_re::xr_file_system::instance();
+	auto reader = file_system.r_open(path);
+	ASSERT_NE(reader, nullptr);
+
+	EntryTable entries;
+	EXPECT_FALSE(Unpacker::read_files(path, reader, xray_re::DBVersion::DB_VERSION_1114, entries));
+	file_system.r_close(reader);
+
+	DBTools::unpack(path, m_root + "out", xray_re::DBVersion::DB_VERSION_1114, "", false, 1);
+	EXPECT_FALSE(fs::exists(m_root + "out/bad.ltx"));
+}
+
+TEST_F(DBArchiveTest, RejectsEntriesOutOfBounds)
+{
+	for(auto version : {xray_re::DBVersion::DB_VERSION_2215, xray_re::DBVersion::DB_VERSION_2945, xray_re::DBVersion::DB_VERSION_XDB})
+	{
+		// a single stored entry that starts inside the data but runs past the end of the file
+		xray_re::xr_memory_writer header;
+		std::string name = "bad.ltx";
+		uint32_t offset = 8, size = 0x10000;
+		if(version == xray_re::DBVersion::DB_VERSION_2215)
+		{
+			header.w_sz(name);
+			header.w_u32(offset);
+			header.w_u32(size);
+			header.w_u32(size);
+		}
+		else if(version == xray_re::DBVersion::DB_VERSION_2945)
+		{
+			header.w_sz(name);
+			header.w_u32(0);
+			header.w_u32(offset);
+			header.w_u32(size);
+			header.w_u32(size);
+		}
+		else
+		{
+			header.w_size_u16(name.size() + 16);
+			header.w_u32(size);
+			header.w_u32(size);
+			header.w_u32(0);
+			header.w_raw(name.data(), name.size());
+			header.w_u32(offset);
+		}
+
+		auto path = m_root + "bounds.db";
+		{
+			xray_re::xr_file_writer_posix w(path);
+			w.open_chunk(xray_re::DB_CHUNK_DATA);
+			w.w_raw("0123456789abcdef", 16);
+			w.close_chunk();
+
+			uint8_t *code = nullptr;
+			uint32_t code_size = 0;
+			xray_re::xr_lzhuf::compress(code, code_size, header.data(), static_cast<uint32_t>(header.tell()));
+			w.open_chunk(xray_re::DB_CHUNK_HEADER | xray_re::CHUNK_COMPRESSED);
+			w.w_raw(code, code_size);
+			w.close_chunk();
+			free(code);
+		}
+
+		auto& file_system = xray_re::xr_file_system::instance();
+		auto reader = file_system.r_open(path);
+		ASSERT_NE(reader, nullptr);
+
+		EntryTable entries;
+		EXPECT_FALSE(Unpacker::read_files(path, reader, version, entries)) << static_cast<int>(version);
+		EXPECT_EQ(entries.size(), 0u);
+		file_system.r_close(reader);
+
+		DBTools::unpack(path, m_root + "out", version, "", false, 1);
+		EXPECT_FALSE(fs::exists(m_root + "out/bad.ltx")) << static_cast<int>(version);
+	}
+}
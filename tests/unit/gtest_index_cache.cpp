@@ -0,0 +1,115 @@
+#include "archive_generator.hxx"
+#include "index_cache.hxx"
+#include "temp_dir_test.hxx"
+#include "unpacker.hxx"
+#include "crc32/crc32.hxx"
+#include "xray_re/xr_file_system.hxx"
+#include "xray_re/xr_reader.hxx"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+using namespace xray_re;
+
+namespace fs = std::filesystem;
+
+class IndexCacheTest : public TempDirTest<>
+{
+protected:
+	IndexCacheTest() : TempDirTest("gtest_index_cache") {}
+
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		fs::create_directories(m_root + "cache/");
+		IndexCache::set_directory(m_root + "cache/");
+	}
+
+	void TearDown() override
+	{
+		IndexCache::set_directory("");
+		TempDirTest::TearDown();
+	}
+
+	ArchiveGenerator generate(uint64_t seed)
+	{
+		ArchiveSpec spec;
+		spec.version = m_version;
+		spec.entries = 30;
+		spec.seed = seed;
+
+		ArchiveGenerator generator(spec);
+		EXPECT_TRUE(generator.write(m_path));
+		return generator;
+	}
+
+	// crc of the raw header chunk, the part of the key that read_files computes
+	uint32_t header_crc()
+	{
+		auto reader = xr_file_system::r_open(m_path);
+		auto size = reader->find_chunk(DB_CHUNK_HEADER);
+		auto crc = crc32(reader->pointer<uint8_t>(), size);
+		xr_file_system::r_close(reader);
+		return crc;
+	}
+
+	EntryTable read_files()
+	{
+		EntryTable entries;
+		auto reader = xr_file_system::r_open(m_path);
+		EXPECT_TRUE(Unpacker::read_files(m_path, reader, m_version, entries));
+		xr_file_system::r_close(reader);
+		return entries;
+	}
+
+	static void expect_entries(const EntryTable& entries, const ArchiveGenerator& generator)
+	{
+		ASSERT_EQ(entries.size(), 30u);
+		for(std::size_t i = 0; i < entries.size(); i++)
+		{
+			EXPECT_EQ(entries.path(i), generator.entry_path(i));
+			EXPECT_EQ(entries.size_real(i), generator.entry_data(i).size());
+		}
+	}
+
+	std::string m_path{m_root + "archive.db"};
+	DBVersion m_version{DBVersion::DB_VERSION_2947RU};
+};
+
+TEST_F(IndexCacheTest, StoresReloadsAndDetectsStaleEntries)
+{
+	auto first = generate(1);
+	auto first_crc = header_crc();
+
+	EntryTable cached;
+	EXPECT_FALSE(IndexCache::load(m_path, m_version, first_crc, cached));
+
+	// a miss parses the header and stores the index
+	expect_entries(read_files(), first);
+	ASSERT_EQ(std::distance(fs::directory_iterator(m_root + "cache/"), fs::directory_iterator()), 1);
+
+	ASSERT_TRUE(IndexCache::load(m_path, m_version, first_crc, cached));
+	expect_entries(cached, first);
+
+	// same archive under another format must not hit
+	EXPECT_FALSE(IndexCache::load(m_path, DBVersion::DB_VERSION_2947WW, first_crc, cached));
+
+	// rewritten archive: the stored key no longer matches, the header is parsed again
+	auto second = generate(2);
+	auto second_crc = header_crc();
+	ASSERT_NE(first_crc, second_crc);
+
+	EXPECT_FALSE(IndexCache::load(m_path, m_version, first_crc, cached));
+	EXPECT_FALSE(IndexCache::load(m_path, m_version, second_crc, cached));
+	expect_entries(read_files(), second);
+
+	ASSERT_TRUE(IndexCache::load(m_path, m_version, second_crc, cached));
+	expect_entries(cached, second);
+
+	// touching the archive is enough to invalidate it
+	fs::last_write_time(m_path, fs::last_write_time(m_path) + std::chrono::seconds(1));
+	EXPECT_FALSE(IndexCache::load(m_path, m_version, second_crc, cached));
+}
@@ -0,0 +1,65 @@
+#include "archive_generator.hxx"
+#include "db_tools.hxx"
+#include "temp_dir_test.hxx"
+#include "xray_re/xr_uring_writer_posix.hxx"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+class IoUringTest : public TempDirTest<testing::TestWithParam<std::pair<bool, std::size_t>>>
+{
+protected:
+	IoUringTest() : TempDirTest("gtest_io_uring") {}
+
+	void SetUp() override
+	{
+		if(!xray_re::xr_uring_writer_posix::is_supported())
+		{
+			GTEST_SKIP() << "io_uring is not available";
+		}
+
+		TempDirTest::SetUp();
+		DBTools::set_io_uring(true);
+	}
+
+	void TearDown() override
+	{
+		DBTools::set_io_uring(false);
+		TempDirTest::TearDown();
+	}
+};
+
+TEST_P(IoUringTest, UnpacksToGeneratedFiles)
+{
+	ArchiveSpec spec;
+	spec.version = xray_re::DBVersion::DB_VERSION_XDB;
+	spec.compress = GetParam().first;
+	// more files than the ring holds, so submissions have to wait for completions
+	spec.entries = 300;
+	spec.min_size = 1;
+	spec.max_size = 64 * 1024;
+	spec.depth = 3;
+	spec.fanout = 4;
+
+	ArchiveGenerator generator(spec);
+	ASSERT_TRUE(generator.write(m_root + "archive.db"));
+
+	DBTools::unpack(m_root + "archive.db", m_root + "out", spec.version, "", false, GetParam().second);
+
+	for(std::size_t i = 0; i < spec.entries; i++)
+	{
+		auto path = generator.entry_path(i);
+		ASSERT_TRUE(fs::is_regular_file(m_root + "out/" + path)) << path;
+		EXPECT_EQ(read(m_root + "out/" + path), generator.entry_data(i)) << path;
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(StoredAndCompressed, IoUringTest, testing::Values(
+	std::make_pair(false, std::size_t(1)),
+	std::make_pair(false, std::size_t(4)),
+	std::make_pair(true, std::size_t(1)),
+	std::make_pair(true, std::size_t(4))));
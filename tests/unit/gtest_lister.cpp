@@ -0,0 +1,112 @@
+#include "archive_generator.hxx"
+#include "db_tools.hxx"
+#include "lister.hxx"
+#include "temp_dir_test.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class ListerTest : public TempDirTest<>
+{
+protected:
+	ListerTest() : TempDirTest("gtest_lister") {}
+
+	std::string list(const std::string& path, xray_re::DBVersion version, ListFormat format)
+	{
+		char *data = nullptr;
+		std::size_t size = 0;
+		auto out = open_memstream(&data, &size);
+
+		EXPECT_TRUE(Lister::process(path, version, format, out));
+		std::fclose(out);
+
+		std::string result(data, size);
+		free(data);
+		return result;
+	}
+};
+
+TEST_F(ListerTest, ListsEveryFileAsTsv)
+{
+	for(auto version : {xray_re::DBVersion::DB_VERSION_1114, xray_re::DBVersion::DB_VERSION_2215, xray_re::DBVersion::DB_VERSION_2945,
+		xray_re::DBVersion::DB_VERSION_2947WW, xray_re::DBVersion::DB_VERSION_XDB})
+	{
+		ArchiveSpec spec;
+		spec.version = version;
+		spec.entries = 20;
+		spec.compress = true;
+
+		ArchiveGenerator generator(spec);
+		ASSERT_TRUE(generator.write(m_root + "archive.db"));
+
+		std::istringstream listing(list(m_root + "archive.db", version, ListFormat::TSV));
+		std::string line;
+		ASSERT_TRUE(std::getline(listing, line));
+		EXPECT_EQ(line, "path\toffset\tsize_real\tsize_compressed\tcrc\tratio");
+
+		for(std::size_t i = 0; i < spec.entries; i++)
+		{
+			ASSERT_TRUE(std::getline(listing, line));
+
+			std::istringstream columns(line);
+			std::string path;
+			std::size_t offset = 0, size_real = 0;
+			columns >> path >> offset >> size_real;
+
+			EXPECT_EQ(path, generator.entry_path(i));
+			EXPECT_EQ(size_real, generator.entry_data(i).size()) << path;
+		}
+
+		EXPECT_FALSE(std::getline(listing, line));
+	}
+}
+
+TEST_F(ListerTest, WritesJsonDocument)
+{
+	ArchiveSpec spec;
+	spec.entries = 3;
+
+	ArchiveGenerator generator(spec);
+	ASSERT_TRUE(generator.write(m_root + "archive.db"));
+
+	auto json = list(m_root + "archive.db", xray_re::DBVersion::DB_VERSION_XDB, ListFormat::JSON);
+	EXPECT_EQ(json.rfind("{\"archive\": \"" + m_root + "archive.db\", \"entries\": [", 0), 0u);
+	EXPECT_NE(json.find("\"path\": \"" + generator.entry_path(2) + "\""), std::string::npos);
+	EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
+
+TEST_F(ListerTest, WritesCp1251PathsAsUtf8)
+{
+	// "Привет.ltx" the way the original tools stored it
+	fs::create_directories(m_root + "source/config");
+	std::ofstream(m_root + "source/config/\xcf\xf0\xe8\xe2\xe5\xf2.ltx") << "[section]";
+
+	ASSERT_TRUE(DBTools::pack(m_root + "source/", m_root + "archive.db", xray_re::DBVersion::DB_VERSION_XDB, "", false));
+
+	auto json = list(m_root + "archive.db", xray_re::DBVersion::DB_VERSION_XDB, ListFormat::JSON);
+	EXPECT_NE(json.find("\"path\": \"config/\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82.ltx\""), std::string::npos) << json;
+	EXPECT_EQ(json.find('\xcf'), std::string::npos);
+}
+
+TEST_F(ListerTest, KeepsUtf8ArchivePath)
+{
+	ArchiveSpec spec;
+	spec.entries = 3;
+
+	// the host file system is UTF-8, only names inside the archive are CP1251
+	auto path = m_root + "\xd0\xb0\xd1\x80\xd1\x85\xd0\xb8\xd0\xb2.db";
+	ArchiveGenerator generator(spec);
+	ASSERT_TRUE(generator.write(path));
+
+	auto json = list(path, xray_re::DBVersion::DB_VERSION_XDB, ListFormat::JSON);
+	EXPECT_EQ(json.rfind("{\"archive\": \"" + path + "\", \"entries\": [", 0), 0u) << json;
+}
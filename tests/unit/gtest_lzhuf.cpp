@@ -0,0 +1,241 @@
+#include "lzhuf_reference.hxx"
+#include "xray_re/xr_lzhuf.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace xray_re;
+
+std::vector<uint8_t> SampleText(unsigned int seed, std::size_t size)
+{
+	static const std::vector<std::string> words =
+	{
+		"textures", "meshes", "\\", "actors", "stalker", ".dds", ".ogf", "[section]", " = ", "\r\n", "level"
+	};
+
+	std::mt19937 generator(seed);
+	std::uniform_int_distribution<std::size_t> word(0, words.size() - 1);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	std::vector<uint8_t> text;
+	while(text.size() < size)
+	{
+		// mostly repetitive, with some noise so that literals are coded too
+		if(generator() % 8 == 0)
+		{
+			text.push_back(static_cast<uint8_t>(byte(generator)));
+		}
+		else
+		{
+			const auto& w = words[word(generator)];
+			text.insert(text.end(), w.begin(), w.end());
+		}
+	}
+
+	text.resize(size);
+	return text;
+}
+
+// xorshift based, so the golden inputs don't depend on the standard library implementation
+std::vector<uint8_t> GoldenText(uint64_t seed, std::size_t size, unsigned int noise)
+{
+	static const char *words[] = {"textures", "meshes", "\\", "actors", "stalker", ".dds", ".ogf", "[section]", " = ", "\r\n", "level"};
+
+	uint64_t state = seed * 0x9e3779b97f4a7c15ull + 1;
+	auto next = [&state]()
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	};
+
+	std::vector<uint8_t> text;
+	while(text.size() < size)
+	{
+		auto value = next();
+		if(value % noise == 0)
+		{
+			text.push_back(static_cast<uint8_t>(value >> 32));
+		}
+		else
+		{
+			std::string_view word(words[(value >> 8) % 11]);
+			text.insert(text.end(), word.begin(), word.end());
+		}
+	}
+
+	text.resize(size);
+	return text;
+}
+
+// streams written by the original tree matcher encoder, see GoldenText for their input
+struct GoldenStream
+{
+	const char *file;
+	uint64_t seed;
+	std::size_t size;
+	unsigned int noise;
+};
+
+static const GoldenStream golden_streams[] =
+{
+	{"lzhuf_text.bin",   1, 3000,   8},
+	{"lzhuf_random.bin", 2, 70000,  1}, // incompressible, the stream itself is over 64 KiB
+	{"lzhuf_long.bin",   3, 300000, 16}
+};
+
+std::vector<uint8_t> ReadGolden(const char *file)
+{
+	std::ifstream stream(std::string(LZHUF_DATA_DIR) + file, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+std::vector<uint8_t> RoundTrip(xr_lzhuf_context& context, const std::vector<uint8_t>& text)
+{
+	uint8_t *code = nullptr;
+	uint32_t code_size = 0;
+	xr_lzhuf::compress(context, code, code_size, text.data(), static_cast<uint32_t>(text.size()));
+
+	uint8_t *decoded = nullptr;
+	uint32_t decoded_size = 0;
+	xr_lzhuf::decompress(context, decoded, decoded_size, code, code_size);
+
+	std::vector<uint8_t> result(decoded, decoded + decoded_size);
+	free(code);
+	free(decoded);
+
+	return result;
+}
+
+TEST(LZHUF, RoundTrip)
+{
+	xr_lzhuf_context context;
+
+	for(std::size_t size : {0, 1, 3, 16, 100, 4095, 4096, 65536, 300000})
+	{
+		auto text = SampleText(static_cast<unsigned int>(size), size);
+		EXPECT_EQ(RoundTrip(context, text), text) << "size " << size;
+	}
+}
+
+TEST(LZHUF, ContextsAreIndependent)
+{
+	std::vector<std::vector<uint8_t>> texts;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		texts.push_back(SampleText(i, 50000 + i * 7919));
+	}
+
+	std::vector<std::vector<uint8_t>> results(texts.size());
+	std::vector<std::thread> threads;
+	for(std::size_t i = 0; i < texts.size(); i++)
+	{
+		threads.emplace_back([&, i]()
+		{
+			// half of the threads use their own contexts, the rest the per-thread default one
+			if(i % 2 == 0)
+			{
+				xr_lzhuf_context context;
+				results[i] = RoundTrip(context, texts[i]);
+			}
+			else
+			{
+				uint8_t *code = nullptr;
+				uint32_t code_size = 0;
+				xr_lzhuf::compress(code, code_size, texts[i].data(), static_cast<uint32_t>(texts[i].size()));
+
+				uint8_t *decoded = nullptr;
+				uint32_t decoded_size = 0;
+				xr_lzhuf::decompress(decoded, decoded_size, code, code_size);
+
+				results[i].assign(decoded, decoded + decoded_size);
+				free(code);
+				free(decoded);
+			}
+		});
+	}
+
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	for(std::size_t i = 0; i < texts.size(); i++)
+	{
+		EXPECT_EQ(results[i], texts[i]) << "text " << i;
+	}
+}
+
+TEST(LZHUF, DecompressIntoCallerBuffer)
+{
+	auto text = SampleText(42, 70000);
+
+	uint8_t *code = nullptr;
+	uint32_t code_size = 0;
+	xr_lzhuf::compress(code, code_size, text.data(), static_cast<uint32_t>(text.size()));
+
+	std::vector<uint8_t> decoded(xr_lzhuf::decompressed_size(code, code_size));
+	ASSERT_EQ(decoded.size(), text.size());
+
+	xr_lzhuf::decompress_into(decoded.data(), static_cast<uint32_t>(decoded.size()), code, code_size);
+	free(code);
+
+	EXPECT_EQ(decoded, text);
+}
+
+TEST(LZHUF, DecodesOriginalEncoderStreams)
+{
+	for(const auto& golden : golden_streams)
+	{
+		auto code = ReadGolden(golden.file);
+		ASSERT_FALSE(code.empty()) << golden.file;
+		auto text = GoldenText(golden.seed, golden.size, golden.noise);
+
+		// the reference decoder has to agree as well, otherwise the checks below prove nothing
+		EXPECT_EQ(LZHUFReference::decode(code.data(), code.size()), text) << golden.file;
+
+		uint8_t *decoded = nullptr;
+		uint32_t decoded_size = 0;
+		xr_lzhuf::decompress(decoded, decoded_size, code.data(), static_cast<uint32_t>(code.size()));
+		EXPECT_EQ(std::vector<uint8_t>(decoded, decoded + decoded_size), text) << golden.file;
+		free(decoded);
+
+		std::vector<uint8_t> buffer(xr_lzhuf::decompressed_size(code.data(), static_cast<uint32_t>(code.size())));
+		ASSERT_EQ(buffer.size(), text.size()) << golden.file;
+		xr_lzhuf::decompress_into(buffer.data(), static_cast<uint32_t>(buffer.size()), code.data(), static_cast<uint32_t>(code.size()));
+		EXPECT_EQ(buffer, text) << golden.file;
+	}
+}
+
+TEST(LZHUF, OriginalDecoderReadsNewStreams)
+{
+	std::vector<std::vector<uint8_t>> texts;
+	for(const auto& golden : golden_streams)
+	{
+		texts.push_back(GoldenText(golden.seed, golden.size, golden.noise));
+	}
+
+	for(std::size_t size : {1, 3, 16, 100, 4095, 4096, 65536, 300000})
+	{
+		texts.push_back(SampleText(static_cast<unsigned int>(size), size));
+	}
+
+	for(const auto& text : texts)
+	{
+		uint8_t *code = nullptr;
+		uint32_t code_size = 0;
+		xr_lzhuf::compress(code, code_size, text.data(), static_cast<uint32_t>(text.size()));
+
+		EXPECT_EQ(LZHUFReference::decode(code, code_size), text) << "size " << text.size();
+		free(code);
+	}
+}
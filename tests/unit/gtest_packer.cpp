@@ -0,0 +1,88 @@
+#include "db_tools.hxx"
+#include "temp_dir_test.hxx"
+#include "xray_re/xr_file_writer_posix.hxx"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class PackerTest : public TempDirTest<>
+{
+protected:
+	PackerTest() : TempDirTest("gtest_packer") {}
+
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		// enough files to keep several workers busy, some compressible, some not, some empty
+		for(std::size_t i = 0; i < 200; i++)
+		{
+			auto folder = m_root + "source/folder_" + std::to_string(i % 7) + "/sub_" + std::to_string(i % 3) + "/";
+			fs::create_directories(folder);
+
+			std::string content;
+			for(std::size_t j = 0; j < (i * 131) % 5000; j++)
+			{
+				content += i % 2 ? static_cast<char>('a' + j % 5) : static_cast<char>((j * 2654435761u + i) >> 13);
+			}
+
+			std::ofstream file(folder + "file_" + std::to_string(i) + ".ltx", std::ios::binary);
+			file << content;
+		}
+	}
+
+	void TearDown() override
+	{
+		DBTools::set_write_buffer_size(xray_re::xr_file_writer_posix::DEFAULT_BUFFER_SIZE);
+		TempDirTest::TearDown();
+	}
+
+	std::vector<uint8_t> pack(std::size_t jobs, xray_re::CompressionLevel compression, bool zero_copy)
+	{
+		auto archive_path = m_root + "archive_" + std::to_string(jobs) + ".db";
+		EXPECT_TRUE(DBTools::pack(m_root + "source/", archive_path, xray_re::DBVersion::DB_VERSION_XDB, "", false, jobs, compression, zero_copy));
+		return read(archive_path);
+	}
+
+	void expect_same_archive(xray_re::CompressionLevel compression, bool zero_copy)
+	{
+		auto single = pack(1, compression, zero_copy);
+		ASSERT_FALSE(single.empty());
+
+		for(std::size_t jobs : {2, 4, 8})
+		{
+			EXPECT_EQ(pack(jobs, compression, zero_copy), single) << jobs << " jobs";
+		}
+	}
+};
+
+TEST_F(PackerTest, JobsDontChangeArchive)
+{
+	expect_same_archive(xray_re::CompressionLevel::NONE, false);
+}
+
+TEST_F(PackerTest, JobsDontChangeCompressedArchive)
+{
+	expect_same_archive(xray_re::CompressionLevel::FAST, false);
+}
+
+TEST_F(PackerTest, JobsDontChangeZeroCopyArchive)
+{
+	expect_same_archive(xray_re::CompressionLevel::NONE, true);
+
+	// the kernel copy must lay out data exactly like the mapped path
+	EXPECT_EQ(pack(1, xray_re::CompressionLevel::NONE, true), pack(1, xray_re::CompressionLevel::NONE, false));
+}
+
+TEST_F(PackerTest, JobsDontChangeUnbufferedArchive)
+{
+	DBTools::set_write_buffer_size(0);
+	expect_same_archive(xray_re::CompressionLevel::NONE, false);
+	expect_same_archive(xray_re::CompressionLevel::NONE, true);
+}
@@ -0,0 +1,90 @@
+#include "path_filter.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(PathFilter, EmptyFilterMatchesEverything)
+{
+	PathFilter filter;
+	EXPECT_TRUE(filter.empty());
+	EXPECT_TRUE(filter.matches("config\\system.ltx"));
+	EXPECT_TRUE(filter.matches(""));
+}
+
+TEST(PathFilter, SubstringIgnoresCaseAndSeparators)
+{
+	PathFilter filter;
+	ASSERT_TRUE(filter.include("Config/Weapons"));
+
+	EXPECT_TRUE(filter.matches("config\\weapons\\w_ak74.ltx"));
+	EXPECT_TRUE(filter.matches("gamedata/config/weapons/w_ak74.ltx"));
+	EXPECT_FALSE(filter.matches("config\\system.ltx"));
+}
+
+TEST(PathFilter, GlobWithoutFolderMatchesFileName)
+{
+	PathFilter filter;
+	ASSERT_TRUE(filter.include("*.ltx"));
+
+	EXPECT_TRUE(filter.matches("system.ltx"));
+	EXPECT_TRUE(filter.matches("config\\weapons\\W_AK74.LTX"));
+	EXPECT_FALSE(filter.matches("config\\system.ltx.bak"));
+	EXPECT_FALSE(filter.matches("config.ltx\\readme.txt"));
+}
+
+TEST(PathFilter, GlobStarsAndClasses)
+{
+	PathFilter single;
+	ASSERT_TRUE(single.include("config/*.ltx"));
+	EXPECT_TRUE(single.matches("config\\system.ltx"));
+	EXPECT_FALSE(single.matches("config\\weapons\\w_ak74.ltx"));
+
+	PathFilter any;
+	ASSERT_TRUE(any.include("config/**.ltx"));
+	EXPECT_TRUE(any.matches("config\\system.ltx"));
+	EXPECT_TRUE(any.matches("config\\weapons\\w_ak74.ltx"));
+	EXPECT_FALSE(any.matches("textures\\config\\a.ltx"));
+
+	PathFilter levels;
+	ASSERT_TRUE(levels.include("config/**/x.ltx"));
+	EXPECT_TRUE(levels.matches("config\\x.ltx"));
+	EXPECT_TRUE(levels.matches("config\\weapons\\x.ltx"));
+	EXPECT_TRUE(levels.matches("config\\weapons\\old\\x.ltx"));
+	EXPECT_FALSE(levels.matches("config\\ax.ltx"));
+	EXPECT_FALSE(levels.matches("configx.ltx"));
+	EXPECT_FALSE(levels.matches("textures\\config\\x.ltx"));
+
+	PathFilter classes;
+	ASSERT_TRUE(classes.include("w_[a-c]?74*.[!o]tx"));
+	EXPECT_TRUE(classes.matches("config\\weapons\\w_ak74.ltx"));
+	EXPECT_TRUE(classes.matches("w_bk74_old.ltx"));
+	EXPECT_FALSE(classes.matches("w_dk74.ltx"));
+	EXPECT_FALSE(classes.matches("w_ak74.otx"));
+}
+
+TEST(PathFilter, Regex)
+{
+	PathFilter filter;
+	ASSERT_TRUE(filter.include("re:^levels/l0[1-3]_"));
+
+	EXPECT_TRUE(filter.matches("levels\\l01_escape\\level"));
+	EXPECT_TRUE(filter.matches("LEVELS/L03_agroprom/level.ai"));
+	EXPECT_FALSE(filter.matches("levels\\l04_darkvalley\\level"));
+
+	PathFilter invalid;
+	EXPECT_FALSE(invalid.include("re:[unterminated"));
+	EXPECT_TRUE(invalid.empty());
+}
+
+TEST(PathFilter, ExcludeWinsOverInclude)
+{
+	PathFilter filter;
+	ASSERT_TRUE(filter.include("config/"));
+	ASSERT_TRUE(filter.include("*.dds"));
+	ASSERT_TRUE(filter.exclude("**/weapons/**"));
+
+	EXPECT_TRUE(filter.matches("config\\system.ltx"));
+	EXPECT_TRUE(filter.matches("textures\\act\\act_stalker.dds"));
+	EXPECT_FALSE(filter.matches("config\\weapons\\w_ak74.ltx"));
+	EXPECT_FALSE(filter.matches("textures\\wpn\\weapons\\ak74.dds"));
+	EXPECT_FALSE(filter.matches("sounds\\ambient.ogg"));
+}
@@ -0,0 +1,60 @@
+#include "archive_generator.hxx"
+#include "db_archive.hxx"
+#include "temp_dir_test.hxx"
+#include "unpacker.hxx"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class VerifyTest : public TempDirTest<testing::TestWithParam<bool>>
+{
+protected:
+	VerifyTest() : TempDirTest("gtest_verify") {}
+
+	void flip_byte(const std::string& path, std::size_t offset)
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekg(offset);
+		char c = 0;
+		file.get(c);
+		file.seekp(offset);
+		file.put(static_cast<char>(c ^ 0x20));
+	}
+};
+
+TEST_P(VerifyTest, ReportsDamagedEntry)
+{
+	ArchiveSpec spec;
+	spec.version = xray_re::DBVersion::DB_VERSION_XDB;
+	spec.entries = 20;
+	spec.min_size = 256;
+	spec.compress = GetParam();
+
+	ArchiveGenerator generator(spec);
+	auto path = m_root + "archive.db";
+	ASSERT_TRUE(generator.write(path));
+
+	std::vector<std::string> damaged;
+	EXPECT_TRUE(Unpacker::verify(path, spec.version, 4, &damaged));
+	EXPECT_TRUE(damaged.empty());
+
+	std::size_t offset = 0, size = 0;
+	{
+		DBArchive archive;
+		ASSERT_TRUE(archive.open(path, spec.version));
+		auto entry = archive.lookup(generator.entry_path(7));
+		ASSERT_NE(entry, DBArchive::npos);
+		offset = archive.entries().offset(entry);
+		size = archive.entries().size_compressed(entry);
+	}
+
+	flip_byte(path, offset + size / 2);
+
+	EXPECT_FALSE(Unpacker::verify(path, spec.version, 4, &damaged));
+	EXPECT_EQ(damaged, std::vector<std::string>{generator.entry_path(7)});
+}
+
+INSTANTIATE_TEST_SUITE_P(StoredAndCompressed, VerifyTest, testing::Bool());
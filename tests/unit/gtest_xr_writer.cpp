@@ -0,0 +1,150 @@
+#include "temp_dir_test.hxx"
+#include "xray_re/xr_file_writer_posix.hxx"
+#include "xray_re/xr_writer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace xray_re;
+
+class XrWriterTest : public TempDirTest<>
+{
+protected:
+	XrWriterTest() : TempDirTest("gtest_xr_writer") {}
+
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		m_source.resize(300 * 1024);
+		for(std::size_t i = 0; i < m_source.size(); i++)
+		{
+			m_source[i] = static_cast<uint8_t>(i * 7 + i / 251);
+		}
+
+		std::ofstream file(m_root + "source.bin", std::ios::binary);
+		file.write(reinterpret_cast<const char*>(m_source.data()), m_source.size());
+	}
+
+	std::vector<uint8_t> m_source;
+};
+
+TEST_F(XrWriterTest, WriteFileCopiesWholeFile)
+{
+	auto fd = ::open((m_root + "source.bin").c_str(), O_RDONLY);
+	ASSERT_NE(fd, -1);
+
+	// the memory writer reads through pread, the file writer lets the kernel copy
+	xr_memory_writer memory;
+	EXPECT_TRUE(memory.w_file(fd, m_source.size()));
+	EXPECT_EQ(std::vector<uint8_t>(memory.data(), memory.data() + memory.tell()), m_source);
+
+	{
+		xr_file_writer_posix file(m_root + "copy.bin");
+		EXPECT_TRUE(file.w_file(fd, m_source.size()));
+	}
+	EXPECT_EQ(read(m_root + "copy.bin"), m_source);
+
+	::close(fd);
+}
+
+TEST_F(XrWriterTest, WriteFileFailsOnShrunkFile)
+{
+	auto fd = ::open((m_root + "source.bin").c_str(), O_RDONLY);
+	ASSERT_NE(fd, -1);
+
+	// the size was taken before the file got shorter
+	ASSERT_EQ(::truncate((m_root + "source.bin").c_str(), 1000), 0);
+
+	xr_memory_writer memory;
+	EXPECT_FALSE(memory.w_file(fd, m_source.size()));
+
+	xr_file_writer_posix file(m_root + "copy.bin");
+	EXPECT_FALSE(file.w_file(fd, m_source.size()));
+
+	::close(fd);
+}
+
+TEST_F(XrWriterTest, WriteFileFailsOnUnreadableDescriptor)
+{
+	auto fd = ::open((m_root + "source.bin").c_str(), O_WRONLY);
+	ASSERT_NE(fd, -1);
+
+	xr_memory_writer memory;
+	EXPECT_FALSE(memory.w_file(fd, m_source.size()));
+	EXPECT_EQ(memory.tell(), 0u);
+
+	xr_file_writer_posix file(m_root + "copy.bin");
+	EXPECT_FALSE(file.w_file(fd, m_source.size()));
+
+	::close(fd);
+}
+
+// chunk sizes are patched in after the data, often far behind the current buffer
+static void WriteChunks(xr_writer& w, const std::vector<uint8_t>& data)
+{
+	w.open_chunk(1);
+	w.w_u32(0xdeadbeef);
+
+	for(uint32_t id = 0; id < 5; id++)
+	{
+		w.open_chunk(100 + id);
+		w.w_raw(data.data(), 37 * id + 3);
+
+		w.open_chunk(200 + id);
+		w.w_raw(data.data() + id, 5000 * id + 1);
+		w.close_chunk();
+
+		w.w_u8(static_cast<uint8_t>(id));
+		w.close_chunk();
+	}
+
+	w.close_chunk();
+	w.w_raw(data.data(), 10);
+}
+
+TEST_F(XrWriterTest, BufferedWriterPatchesChunkSizesAcrossFlushes)
+{
+	xr_memory_writer expected;
+	WriteChunks(expected, m_source);
+	std::vector<uint8_t> expected_data(expected.data(), expected.data() + expected.tell());
+
+	for(std::size_t buffer_size : {0, 1, 3, 8, 16, 4096, 1 << 20})
+	{
+		auto path = m_root + "chunks_" + std::to_string(buffer_size) + ".bin";
+		{
+			xr_file_writer_posix w(path, buffer_size);
+			WriteChunks(w, m_source);
+			EXPECT_EQ(w.tell(), expected_data.size());
+		}
+
+		EXPECT_EQ(read(path), expected_data) << "buffer size " << buffer_size;
+	}
+}
+
+TEST_F(XrWriterTest, BufferedWriterOverwritesFlushedData)
+{
+	auto path = m_root + "overwrite.bin";
+	{
+		xr_file_writer_posix w(path, 16);
+		w.w_raw(m_source.data(), 40);
+
+		// the first bytes went to the file already, the rewrite straddles the flushed part and the buffer
+		w.seek(10);
+		const char patch[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+		w.w_raw(patch, 25);
+
+		w.seek(40);
+		w.w_raw(m_source.data() + 40, 10);
+	}
+
+	auto expected = std::vector<uint8_t>(m_source.begin(), m_source.begin() + 50);
+	std::copy_n("0123456789abcdefghijklmno", 25, expected.begin() + 10);
+	EXPECT_EQ(read(path), expected);
+}
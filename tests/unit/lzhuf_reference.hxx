@@ -0,0 +1,340 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// The LZHUF decoder as the original xray_re shipped it, reading the stream bit by bit. Output of
+// the current encoder is checked against it, so encoder and decoder can't drift from the format together.
+class LZHUFReference
+{
+public:
+	static std::vector<uint8_t> decode(const uint8_t *code, std::size_t code_size)
+	{
+		LZHUFReference lzhuf;
+		return lzhuf.run(code, code_size);
+	}
+
+private:
+	enum
+	{
+		N = 4096,
+		F = 60,
+		THRESHOLD = 2,
+		MAX_FREQ = 0x4000,
+		N_CHAR = 256 - THRESHOLD + F,
+		T = N_CHAR * 2 - 1,
+		R = T - 1
+	};
+
+	static constexpr std::array<uint8_t, 256> d_code =
+	{
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+		0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+		0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+		0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09,
+		0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+		0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B,
+		0x0C, 0x0C, 0x0C, 0x0C, 0x0D, 0x0D, 0x0D, 0x0D,
+		0x0E, 0x0E, 0x0E, 0x0E, 0x0F, 0x0F, 0x0F, 0x0F,
+		0x10, 0x10, 0x10, 0x10, 0x11, 0x11, 0x11, 0x11,
+		0x12, 0x12, 0x12, 0x12, 0x13, 0x13, 0x13, 0x13,
+		0x14, 0x14, 0x14, 0x14, 0x15, 0x15, 0x15, 0x15,
+		0x16, 0x16, 0x16, 0x16, 0x17, 0x17, 0x17, 0x17,
+		0x18, 0x18, 0x19, 0x19, 0x1A, 0x1A, 0x1B, 0x1B,
+		0x1C, 0x1C, 0x1D, 0x1D, 0x1E, 0x1E, 0x1F, 0x1F,
+		0x20, 0x20, 0x21, 0x21, 0x22, 0x22, 0x23, 0x23,
+		0x24, 0x24, 0x25, 0x25, 0x26, 0x26, 0x27, 0x27,
+		0x28, 0x28, 0x29, 0x29, 0x2A, 0x2A, 0x2B, 0x2B,
+		0x2C, 0x2C, 0x2D, 0x2D, 0x2E, 0x2E, 0x2F, 0x2F,
+		0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+		0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+	};
+
+	static constexpr std::array<uint8_t, 256> d_len =
+	{
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+		0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+	};
+
+	std::vector<uint8_t> run(const uint8_t *code, std::size_t code_size)
+	{
+		uint32_t textsize = 0;
+		std::memcpy(&textsize, code, sizeof(textsize));
+
+		m_src = code;
+		m_src_pos = 4;
+		m_src_limit = code_size;
+
+		getbuf = 0;
+		getlen = 0;
+
+		StartHuff();
+		for(int i = 0; i < N - F; i++)
+		{
+			text_buf[i] = ' ';
+		}
+
+		std::vector<uint8_t> text;
+		text.reserve(textsize);
+
+		auto r = N - F;
+		while(text.size() < textsize)
+		{
+			auto c = DecodeChar();
+			if(c < 256)
+			{
+				text.push_back(static_cast<uint8_t>(c));
+				text_buf[r++] = static_cast<unsigned char>(c);
+				r &= (N - 1);
+			}
+			else
+			{
+				auto i = (r - DecodePosition() - 1) & (N - 1);
+				auto j = c - 255 + THRESHOLD;
+
+				for(int k = 0; k < j; k++)
+				{
+					c = text_buf[(i + k) & (N - 1)];
+					text.push_back(static_cast<uint8_t>(c));
+					text_buf[r++] = static_cast<unsigned char>(c);
+					r &= (N - 1);
+				}
+			}
+		}
+
+		// like the original, a match may run past the stored size
+		text.resize(textsize);
+		return text;
+	}
+
+	int getc()
+	{
+		return m_src_pos < m_src_limit ? m_src[m_src_pos++] : -1;
+	}
+
+	int GetBit()
+	{
+		int i;
+
+		while(getlen <= 8)
+		{
+			if((i = getc()) < 0)
+			{
+				i = 0;
+			}
+
+			getbuf |= static_cast<unsigned int>(i << (8 - getlen));
+			getlen += 8;
+		}
+
+		i = static_cast<int>(getbuf);
+		getbuf <<= 1;
+		getlen--;
+
+		return (i >> 15) & 1;
+	}
+
+	int GetByte()
+	{
+		int i;
+
+		while(getlen <= 8)
+		{
+			int c = getc();
+			i = (c < 0) ? 0 : c;
+			getbuf |= static_cast<unsigned int>(i << (8 - getlen));
+			getlen += 8;
+		}
+
+		i = static_cast<int>(getbuf);
+		getbuf <<= 8;
+		getlen -= 8;
+
+		return (i & 0xff00) >> 8;
+	}
+
+	void StartHuff()
+	{
+		for(int i = 0; i < N_CHAR; i++)
+		{
+			freq[i] = 1;
+			son[i] = i + T;
+			prnt[i + T] = i;
+		}
+
+		for(int i = 0, j = N_CHAR; j <= R; i += 2, j++)
+		{
+			freq[j] = freq[i] + freq[i + 1];
+			son[j] = i;
+			prnt[i] = prnt[i + 1] = j;
+		}
+
+		freq[T] = 0xffff;
+		prnt[R] = 0;
+	}
+
+	void reconst()
+	{
+		for(int i = 0, j = 0; i < T; i++)
+		{
+			if(son[i] >= T)
+			{
+				freq[j] = (freq[i] + 1) / 2;
+				son[j] = son[i];
+				j++;
+			}
+		}
+
+		for(int i = 0, j = N_CHAR; j < T; i += 2, j++)
+		{
+			auto k = i + 1;
+			auto f = freq[j] = freq[i] + freq[k];
+
+			k = j - 1;
+			while(f < freq[k])
+			{
+				k--;
+			}
+			k++;
+
+			auto l = static_cast<unsigned int>(j - k) * sizeof(freq[0]);
+			std::memmove(&freq[k + 1], &freq[k], l);
+			freq[k] = f;
+			std::memmove(&son[k + 1], &son[k], l);
+			son[k] = i;
+		}
+
+		for(int i = 0; i < T; i++)
+		{
+			int k = son[i];
+			prnt[k] = k >= T ? i : prnt[k + 1] = i;
+		}
+	}
+
+	void update(int c)
+	{
+		if(freq[R] == MAX_FREQ)
+		{
+			reconst();
+		}
+		c = prnt[c + T];
+
+		do
+		{
+			auto k = ++freq[c];
+			auto l = c + 1;
+
+			if(k > freq[l])
+			{
+				while(k > freq[++l]);
+				l--;
+				freq[c] = freq[l];
+				freq[l] = k;
+
+				int i = son[c];
+				prnt[i] = l;
+				if(i < T)
+				{
+					prnt[i + 1] = l;
+				}
+
+				int j = son[l];
+				son[l] = i;
+
+				prnt[j] = c;
+				if(j < T)
+				{
+					prnt[j + 1] = c;
+				}
+				son[c] = j;
+
+				c = l;
+			}
+		}
+		while((c = prnt[c]) != 0);
+	}
+
+	int DecodeChar()
+	{
+		auto c = son[R];
+		while(c < T)
+		{
+			c += GetBit();
+			c = son[c];
+		}
+
+		c -= T;
+		update(c);
+		return c;
+	}
+
+	int DecodePosition()
+	{
+		auto i = GetByte();
+		auto c = d_code.at(i) << 6;
+		auto j = d_len.at(i);
+
+		j -= 2;
+		while(j--)
+		{
+			i = (i << 1) + GetBit();
+		}
+		return c | (i & 0x3f);
+	}
+
+	unsigned char text_buf[N + F - 1];
+	unsigned int freq[T + 1];
+	int prnt[T + N_CHAR];
+	int son[T];
+
+	const uint8_t *m_src{nullptr};
+	std::size_t m_src_pos{0};
+	std::size_t m_src_limit{0};
+
+	unsigned int getbuf{0};
+	unsigned char getlen{0};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// whole contents of a file, empty if it can't be read
+inline std::vector<uint8_t> ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Fixture base that gives every test an empty /tmp/db_converter/<name>/ in m_root and removes it
+// afterwards. Base is testing::Test or a testing::TestWithParam for parameterized suites.
+template<typename Base = testing::Test>
+class TempDirTest : public Base
+{
+protected:
+	explicit TempDirTest(const std::string& name) :
+		m_root("/tmp/db_converter/" + name + "/") {}
+
+	void SetUp() override
+	{
+		std::filesystem::remove_all(m_root);
+		std::filesystem::create_directories(m_root);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static std::vector<uint8_t> read(const std::string& path)
+	{
+		return ReadFile(path);
+	}
+
+	std::string m_root;
+};